@@ -0,0 +1,109 @@
+// vi: ts=2 sts=2 sw=2 et tw=100
+/* Checks gauss_integral_c() and gauss_integral_c_batch() against gammq(), which they replaced, and
+ * against a long double reference, then times the three.
+ *
+ *   cmake --build build --target chi_tail && build/chi_tail
+ */
+#include "../stat_math.h"
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+double gammq(double, double);
+
+#define MAX_N 30
+#define MAX_R 38.0  // Q(1/2, MAX_R^2/2) is near the smallest normal double
+#define STEP_R 0.01
+#define TIMED (1 << 20)
+
+/* Q(n/2, r*r/2), summing its closed form in long double. */
+static long double reference(double r, int n)
+{
+  long double x = (long double)r * r / 2.0L, h = (n % 2) ? 0.5L : 0.0L, sum = 0.0L;
+  if (x == 0.0L)
+    return 1.0L;
+  for (int j = 0; n / 2 > j; ++j)
+    sum += expl(-x + (j + h) * logl(x) - lgammal(j + h + 1.0L));
+  return (n % 2) ? sum + erfcl(sqrtl(x)) : sum;
+}
+
+/* The largest relative errors, over the bulk (Q > 1e-15) and over the far tail. */
+typedef struct worst {
+  double bulk, tail;
+  int bulk_n, tail_n;
+  double bulk_r, tail_r;
+} worst_t;
+
+static void note(worst_t *w, double q, long double ref, int n, double r)
+{
+  double e = (double)fabsl((q - ref) / ref);
+  if (ref > 1e-15L && e > w->bulk) {
+    w->bulk = e;
+    w->bulk_n = n;
+    w->bulk_r = r;
+  }
+  if (e > w->tail) {
+    w->tail = e;
+    w->tail_n = n;
+    w->tail_r = r;
+  }
+}
+
+static void print_worst(const char *name, const worst_t *w)
+{
+  printf("%-24s %9.2e (n %2d, r %5.2f) %9.2e (n %2d, r %5.2f)\n", name, w->bulk, w->bulk_n,
+         w->bulk_r, w->tail, w->tail_n, w->tail_r);
+}
+
+static double ns_per_call(clock_t start, clock_t stop)
+{
+  return 1e9 * (double)(stop - start) / CLOCKS_PER_SEC / TIMED;
+}
+
+int main(void)
+{
+  enum { NUM_R = (int)(MAX_R / STEP_R) + 1 };
+  static double r[NUM_R], q[NUM_R];
+  worst_t old = {0}, single = {0}, batch = {0};
+
+  for (int i = 0; NUM_R > i; ++i)
+    r[i] = i * STEP_R;
+  for (int n = 1; MAX_N >= n; ++n) {
+    gauss_integral_c_batch(r, q, NUM_R, n);
+    for (int i = 0; NUM_R > i; ++i) {
+      long double ref = reference(r[i], n);
+      if (ref < 1e-300L)
+        break;  // past the smallest normal double
+      note(&old, gammq(n / 2.0, r[i] * r[i] / 2.0), ref, n, r[i]);
+      note(&single, gauss_integral_c(r[i], n), ref, n, r[i]);
+      note(&batch, q[i], ref, n, r[i]);
+    }
+  }
+  printf("relative error, n = 1..%d, r = 0..%g by %g\n", MAX_N, MAX_R, STEP_R);
+  printf("%-24s %26s %26s\n", "", "Q > 1e-15", "Q > 1e-300");
+  print_worst("gammq", &old);
+  print_worst("gauss_integral_c", &single);
+  print_worst("gauss_integral_c_batch", &batch);
+
+  static double rt[TIMED], qt[TIMED];
+  double sum = 0.0;  // keeps the calls from being optimized away
+  for (int i = 0; TIMED > i; ++i)
+    rt[i] = 8.0 * i / TIMED;
+  printf("\nns per call, r = 0..8\n%4s %9s %17s %23s\n", "n", "gammq", "gauss_integral_c",
+         "gauss_integral_c_batch");
+  for (int n = 4; MAX_N >= n; n += 10) {
+    clock_t c0 = clock();
+    for (int i = 0; TIMED > i; ++i)
+      sum += gammq(n / 2.0, rt[i] * rt[i] / 2.0);
+    clock_t c1 = clock();
+    for (int i = 0; TIMED > i; ++i)
+      sum += gauss_integral_c(rt[i], n);
+    clock_t c2 = clock();
+    gauss_integral_c_batch(rt, qt, TIMED, n);
+    clock_t c3 = clock();
+    sum += qt[TIMED / 2];
+    printf("%4d %9.1f %17.1f %23.1f\n", n, ns_per_call(c0, c1), ns_per_call(c1, c2),
+           ns_per_call(c2, c3));
+  }
+  return sum < 0.0;
+}
@@ -1,21 +1,24 @@
 // vi: ts=2 sts=2 sw=2 et tw=100
 #include "call_spice.h"
+#include "cli_sim.h"
 #include "config.h"
 #include "malt.h"
 #include "space.h"
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
-/* Creates SPICE input files that are used by other routines.
- *
- * Returns 0 if opening any of the files fails.
- */
-static int generic_spice_files(const Configuration *C)
+/* Creates SPICE input files that are used by other routines. */
+static void generic_spice_files(const Configuration *C)
 {
   // these files go in the root of the working tree
   const char *wd = C->working_tree.ptr[0];
@@ -38,8 +41,6 @@ static int generic_spice_files(const Configuration *C)
 
 #undef CREATE_FILE
   free(filename);
-
-  return 1;
 }
 
 /* remake pname file whenever included/excluded parameters change */
@@ -60,27 +61,293 @@ void pname(Configuration *C)
   fclose(fp);
 }
 
+/* The host slots are a pool of lock files in C->options.slot_pool, shared by every malt process on
+ * the host. A slot is held by holding a write lock on its file, so that the slots of a process that
+ * dies are given back by the kernel. Each run also holds a lock on byte 0 of its own
+ * run.<uid>.<pid> file for as long as it is alive (from before the file has that name), and on
+ * byte 1 while it is waiting for a slot; this is how the runs find out about each other to share
+ * the slots fairly.
+ *
+ * Beware that closing any descriptor of a file drops all of this process' locks on it, so the lock
+ * files of the pool stay open until exit.
+ */
+static struct {
+  int num;       // number of slots, or 0 before the pool is opened
+  int *fd;       // lock file of each slot
+  pid_t *owner;  // wrspice process holding each of our slots (-1 if reserved, 0 if not ours)
+  int run_fd;    // lock file of this run
+  char *dir;
+  char *run_name;
+} pool = {0, NULL, NULL, -1, NULL, NULL};
+
+/* Locks (F_WRLCK) or unlocks (F_UNLCK) one byte of a lock file without waiting.
+ * Returns 1 if successful. */
+static int lock_byte(int fd, off_t offset, short type)
+{
+  struct flock fl = {.l_type = type, .l_whence = SEEK_SET, .l_start = offset, .l_len = 1};
+  return fcntl(fd, F_SETLK, &fl) != -1;
+}
+
+/* Returns the PID of the (other) process holding a lock on one byte of a lock file, or 0. */
+static pid_t lock_holder(int fd, off_t offset)
+{
+  struct flock fl = {.l_type = F_WRLCK, .l_whence = SEEK_SET, .l_start = offset, .l_len = 1};
+  if (fcntl(fd, F_GETLK, &fl) == -1 || fl.l_type == F_UNLCK)
+    return 0;
+  return fl.l_pid;
+}
+
+static int open_lock_file(const Configuration *C, const char *name)
+{
+  int fd = open(name, O_RDWR | O_CREAT, 0666);
+  if (fd == -1) {
+    error("Cannot open the host slot file %s\n", name);
+  }
+  fchmod(fd, 0666);  // the pool is shared with other users
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+/* Takes this run out of the pool at exit (its locks go away by themselves). */
+static void pool_leave(void)
+{
+  static pid_t pid = 0;
+  if (pid == 0)
+    pid = getpid();  // registered in the parent; not for a child whose exec failed
+  else if (pid == getpid()) {
+    unlink(pool.run_name);
+    free(pool.run_name);  // mem:gimbal
+    free(pool.owner);     // mem:haslet
+    free(pool.fd);        // mem:lorimer
+    free(pool.dir);       // mem:pottle
+  }
+}
+
+/* Opens the pool of host slots and announces this run in it. */
+static void pool_open(const Configuration *C)
+{
+  char *name = NULL;
+
+  pool.dir = strdup(C->options.slot_pool);  // mem:pottle
+  if (mkdir(pool.dir, 01777) == 0) {
+    chmod(pool.dir, 01777);  // in spite of the umask
+  } else if (errno != EEXIST) {
+    error("Cannot create the host slot pool %s\n", pool.dir);
+  }
+  pool.fd = malloc(C->options.host_slots * sizeof *pool.fd);       // mem:lorimer
+  pool.owner = calloc(C->options.host_slots, sizeof *pool.owner);  // mem:haslet
+  for (int i = 0; i < C->options.host_slots; ++i) {
+    resprintf(&name, "%s/slot.%d", pool.dir, i);  // mem:cresset
+    pool.fd[i] = open_lock_file(C, name);
+  }
+  free(name);  // mem:cresset
+  /* the run file is locked under another name first, as pool_fair() unlinks one left unlocked */
+  long uid = (long)getuid(), pid = (long)getpid();
+  char *new_name = resprintf(NULL, "%s/new.%ld.%ld", pool.dir, uid, pid);  // mem:frumenty
+  pool.run_name = resprintf(NULL, "%s/run.%ld.%ld", pool.dir, uid, pid);   // mem:gimbal
+  pool.run_fd = open_lock_file(C, new_name);
+  lock_byte(pool.run_fd, 0, F_WRLCK);
+  if (rename(new_name, pool.run_name) == -1) {
+    error("Cannot announce this run in the host slot pool as %s\n", pool.run_name);
+  }
+  free(new_name);  // mem:frumenty
+  pool_leave();
+  atexit(pool_leave);
+  pool.num = C->options.host_slots;
+}
+
+/* Returns 1 if this run may take a free slot now: either it holds less than its fair share, or
+ * no other run that holds less than its own share is waiting for one.
+ *
+ * The slots are shared equally between the users with malt runs on the host, and each user's share
+ * equally between their runs. */
+static int pool_fair(void)
+{
+  struct run {
+    long uid, pid;
+    int waiting, held;
+  } *runs = NULL;
+  int num_runs = 0;
+  char *name = NULL;
+
+  /* find the live runs, cleaning up after dead ones */
+  DIR *dir = opendir(pool.dir);
+  for (struct dirent *e; dir != NULL && (e = readdir(dir)) != NULL;) {
+    long uid, pid;
+    if (sscanf(e->d_name, "run.%ld.%ld", &uid, &pid) != 2)
+      continue;
+    runs = realloc(runs, (num_runs + 1) * sizeof *runs);  // mem:hurdies
+    runs[num_runs] = (struct run){uid, pid, 0, 0};
+    if (pid == (long)getpid()) {
+      ++num_runs;
+      continue;
+    }
+    resprintf(&name, "%s/%s", pool.dir, e->d_name);  // mem:jorum
+    int fd = open(name, O_RDWR);
+    if (fd == -1)
+      continue;
+    if (lock_holder(fd, 0)) {
+      runs[num_runs++].waiting = (lock_holder(fd, 1) != 0);
+    } else {
+      unlink(name);
+    }
+    close(fd);
+  }
+  if (dir != NULL)
+    closedir(dir);
+  free(name);  // mem:jorum
+
+  /* count the slots each run holds */
+  for (int i = 0; i < pool.num; ++i) {
+    long pid = pool.owner[i] ? (long)getpid() : (long)lock_holder(pool.fd[i], 0);
+    for (int r = 0; pid && r < num_runs; ++r)
+      if (runs[r].pid == pid)
+        ++runs[r].held;
+  }
+
+  /* shares */
+  int users = 0, me = -1, fair = 1;
+  for (int r = 0; r < num_runs; ++r) {
+    int first = 1;
+    for (int q = 0; q < r; ++q)
+      first &= (runs[q].uid != runs[r].uid);
+    users += first;
+    if (runs[r].pid == (long)getpid())
+      me = r;
+  }
+  for (int r = 0; users > 0 && r < num_runs; ++r) {
+    int siblings = 0;
+    for (int q = 0; q < num_runs; ++q)
+      siblings += (runs[q].uid == runs[r].uid);
+    int share = pool.num / users / siblings;
+    if (share < 1)
+      share = 1;
+    if (r == me && runs[r].held < share) {
+      fair = 1;
+      break;
+    }
+    if (r != me && runs[r].waiting && runs[r].held < share)
+      fair = 0;
+  }
+  free(runs);  // mem:hurdies
+  return fair;
+}
+
+/* Reserves a host slot for the next start_spice call, if host_slots is configured.
+ *
+ * If `block` is nonzero, waits for a slot to be free; do not block while holding slots of finished
+ * but unreaped wrspice processes.
+ *
+ * Returns 1 if a slot is reserved (or there is no host-wide limit), 0 otherwise. */
+int spice_slot_reserve(const Configuration *C, int block)
+{
+  if (C->options.host_slots <= 0)
+    return 1;
+  if (pool.num == 0)
+    pool_open(C);
+  for (int i = 0; i < pool.num; ++i)
+    if (pool.owner[i] == -1)
+      return 1;  // already reserved
+  for (;;) {
+    if (pool_fair()) {
+      for (int i = 0; i < pool.num; ++i) {
+        if (pool.owner[i] == 0 && lock_byte(pool.fd[i], 0, F_WRLCK)) {
+          pool.owner[i] = -1;
+          lock_byte(pool.run_fd, 1, F_UNLCK);
+          return 1;
+        }
+      }
+    }
+    if (!block)
+      return 0;
+    /* let the others know that we are waiting, and poll */
+    lock_byte(pool.run_fd, 1, F_WRLCK);
+    nanosleep(&(struct timespec){0, 100000000}, NULL);
+  }
+}
+
+/* Assigns the reserved host slot to the process `pid`, or gives it back if `pid` is not one. */
+static void slot_assign(pid_t pid)
+{
+  for (int i = 0; i < pool.num; ++i) {
+    if (pool.owner[i] == -1) {
+      pool.owner[i] = pid;
+      if (pid <= 0) {
+        pool.owner[i] = 0;
+        lock_byte(pool.fd[i], 0, F_UNLCK);
+      }
+      return;
+    }
+  }
+}
+
+/* Waits for the wrspice process `pid` (or any of them, if `pid` is -1) to finish, and gives back
+ * its host slot.
+ *
+ * Returns the PID of the process that finished.
+ */
+pid_t wait_spice(const Configuration *C, pid_t pid)
+{
+  int status;
+  pid_t w;
+  do {
+    if (-1 == (w = waitpid(pid, &status, 0))) {
+      perror("malt: waitpid");
+      exit(EXIT_FAILURE);
+    }
+  } while (!WIFEXITED(status));  // TODO: this is probably bogus ~ntj
+
+  for (int i = 0; i < pool.num; ++i) {
+    if (pool.owner[i] == w) {
+      pool.owner[i] = 0;
+      lock_byte(pool.fd[i], 0, F_UNLCK);
+    }
+  }
+
+  int err = WEXITSTATUS(status);
+  if (err != 0) {
+    fprintf(stderr, "malt: %s returned an error (%d)\n", C->options.spice_call_name, err);
+    perror("malt");
+  }
+  return w;
+}
+
 /* Writes the input (.call) file and calls SPICE to perform a binary search.
  *
  * Returns the PID of the spawned SPICE process.
  *
+ * If host_slots is configured, a host slot is reserved first (waiting for one if necessary).
+ *
  * `accuracy` is the tolerance of the binsearch algorithm
  * `pc` is the center point of the search (inner edge)
  * `po` is the outer edge of the search
+ * `dashc` skips the simulation of `pc`, which is known to pass
  * `call` is the name of the input file to SPICE
  * `returnn` is the name of the output file.
  */
-pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *po, const char *call,
-                  const char *returnn)
+pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *po, int dashc,
+                  const char *call, const char *returnn)
 {
-  FILE *fp;
-  int i;
-  static int dasht = 1;
+  const Backend *backend = find_backend(C->options.backend);
 
   /* generic file generation */
   if (C->function == 'd') {
-    generic_spice_files(C);
+    backend->prepare(C);
   }
+  spice_slot_reserve(C, 1);
+  pid_t pid = backend->start(C, accuracy, pc, po, dashc, call, returnn);
+  slot_assign(pid);
+  return pid;
+}
+
+/* Starts WRspice on the .call file, which sources malt.binsearch (or malt.run for define). */
+static pid_t wrspice_start(const Configuration *C, double accuracy, double *pc, double *po,
+                           int dashc, const char *call, const char *returnn)
+{
+  FILE *fp;
+  int i;
+  static int dasht = 1;
+
   /* malt2spice file */
   if ((fp = fopen(call, "w")) == NULL) {
     fprintf(stderr, "malt: Cannot write to the '%s' file", call);
@@ -101,10 +368,7 @@ pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *p
   fprintf(fp, ")\n");
   /* * * yield routine (or not) * * */
   /* skip the nominal sim for efficiency, after the initial margins */
-  if (C->function == 'y' && C->func_init == 0)
-    fprintf(fp, "dashc = 1\n");
-  else
-    fprintf(fp, "dashc = 0\n");
+  fprintf(fp, "dashc = %d\n", dashc ? 1 : 0);
   /* * * trace routine (or not) * * */
   if (C->function == 't') {
     fprintf(fp, "dasht = %d\n", dasht);
@@ -139,10 +403,16 @@ pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *p
       fprintf(fp, "po[%i]=%g\n", i + 1, physspace(pc[i], C, i));
       fprintf(fp, "pl[%i]=%d\n", i + 1, C->params[i].logs);
     }
-    /* tack on the excluded parameters */
+    /* tack on the excluded parameters, the ones that follow the principal components moving with
+     * them */
     for (; C->num_params_all > i; ++i) {
-      fprintf(fp, "pc[%i]=%g\n", i + 1, C->params[i].nominal);
-      fprintf(fp, "po[%i]=%g\n", i + 1, C->params[i].nominal);
+      if (C->params[i].load) {
+        fprintf(fp, "pc[%i]=%g\n", i + 1, physspace(malt_at(pc, C, i), C, i));
+        fprintf(fp, "po[%i]=%g\n", i + 1, physspace(malt_at(po, C, i), C, i));
+      } else {
+        fprintf(fp, "pc[%i]=%g\n", i + 1, C->params[i].nominal);
+        fprintf(fp, "po[%i]=%g\n", i + 1, C->params[i].nominal);
+      }
       fprintf(fp, "pl[%i]=%d\n", i + 1, C->params[i].logs);
     }
     fprintf(fp, "\nsource %s/%s\n\n.endc\n", C->working_tree.ptr[0], MALT_BINSEARCH_FILENAME);
@@ -176,6 +446,20 @@ pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *p
   return wrspice;
 }
 
+static const Backend backends[] = {
+    {"wrspice", "wrspice", generic_spice_files, wrspice_start, readData, spicePlot},
+    {"cli", "josim-cli", cli_prepare, cli_start, cli_read_nominal, NULL},
+};
+
+/* Returns the simulator backend called `name`, or NULL if there is none such. */
+const Backend *find_backend(const char *name)
+{
+  for (size_t i = 0; i < sizeof backends / sizeof *backends; ++i)
+    if (strcmp(backends[i].name, name) == 0)
+      return &backends[i];
+  return NULL;
+}
+
 /* Calls start_spice and waits for the wrspice process to finish before returning.
  *
  * define calls this function.
@@ -183,20 +467,9 @@ pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *p
 void call_spice(const Configuration *C, double accuracy, double *pc, double *po, const char *call,
                 const char *returnn)
 {
-  pid_t wrspice = start_spice(C, accuracy, pc, po, call, returnn);
+  pid_t wrspice = start_spice(C, accuracy, pc, po, C->function == 'y' && C->func_init == 0, call,
+                              returnn);
   assert(wrspice > 0);
 
-  int status;
-  do {
-    if (-1 == waitpid(wrspice, &status, 0)) {
-      perror("malt: waitpid");
-      exit(EXIT_FAILURE);
-    }
-  } while (!WIFEXITED(status));  // TODO: this is probably bogus ~ntj
-
-  int err = WEXITSTATUS(status);
-  if (err != 0) {
-    fprintf(stderr, "malt: %s returned an error (%d)\n", C->options.spice_call_name, err);
-    perror("malt");
-  }
+  wait_spice(C, wrspice);
 }
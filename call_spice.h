@@ -4,6 +4,7 @@
 #define CALL_SPICE
 
 #include "config.h"
+#include "define.h"
 #include <sys/types.h>
 
 #define LINE_LENGTH 1024
@@ -13,11 +14,34 @@
 #define MALT_RUN_FILENAME "malt.run"
 #define MALT_PASSFAIL_FILENAME "malt.passfail"
 
+/* A simulator backend.
+ *
+ * `prepare` writes whatever the backend needs before the first simulation (called by define).
+ * `start` evaluates a point, or runs a binary search between two points, in a subprocess; the
+ * result goes to the .return file (see start_spice). With `dashc`, the inner point is taken to pass
+ * without simulating it.
+ * `read_nominal` reads the waveforms of the nominal simulation for define.
+ * `plot` shows the envelope, if the backend can.
+ */
+typedef struct backend {
+  const char *name;
+  const char *command;  // the simulator run when [simulator] command is not set
+  void (*prepare)(const Configuration *C);
+  pid_t (*start)(const Configuration *C, double accuracy, double *pc, double *po, int dashc,
+                 const char *call, const char *returnn);
+  int (*read_nominal)(Configuration *C, Data *D, int *scramble);
+  void (*plot)(Configuration *C);
+} Backend;
+
+const Backend *find_backend(const char *name);
+
 void pname(Configuration *);
-pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *po, const char *call,
-                  const char *returnn);
+pid_t start_spice(const Configuration *C, double accuracy, double *pc, double *po, int dashc,
+                  const char *call, const char *returnn);
 void call_spice(const Configuration *C, double accuracy, double *pc, double *po, const char *call,
                 const char *returnn);
+int spice_slot_reserve(const Configuration *C, int block);
+pid_t wait_spice(const Configuration *C, pid_t pid);
 int spice_dice(Configuration *);
 
 /* generic spice file malt.run */
@@ -0,0 +1,448 @@
+// vi: ts=2 sts=2 sw=2 et tw=100
+/* one-shot command-line simulator backend (JoSIM and the like) */
+#include "cli_sim.h"
+#include "config.h"
+#include "define.h"
+#include "malt.h"
+#include "space.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> /* for strcasecmp */
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* The simulator is run as `command -o <output.csv> <deck.cir>`, on a deck that sets every parameter
+ * with .param and then includes the circuit file. It writes the waveforms as CSV with a header line
+ * of vector names, time first. The [nodes] are the names of the CSV columns to check.
+ *
+ * The binary search that the WRspice backend does in malt.binsearch is done here instead, in a
+ * subprocess of malt so that the searches still run in parallel, and pass/fail is decided by
+ * checking the waveforms against the envelope file in malt.
+ */
+
+typedef struct wave {
+  int length;
+  double *t;
+  double **x;  // [node][point], in the order of C->nodes
+} Wave;
+
+typedef struct envelope {
+  int length;
+  double *t;
+  double **hi;  // [node][point], in the order of C->nodes
+  double **lo;
+} Envelope;
+
+static void wave_free(const Configuration *C, Wave *W)
+{
+  for (int i = 0; W->x && C->num_nodes > i; ++i)
+    free(W->x[i]);  // mem:kelpie
+  free(W->x);       // mem:quillwort
+  free(W->t);       // mem:jointress
+  W->x = NULL;
+  W->t = NULL;
+}
+
+static void envelope_free(const Configuration *C, Envelope *E)
+{
+  for (int k = 0; C->num_nodes > k; ++k) {
+    free(E->hi[k]);  // mem:orpiment
+    free(E->lo[k]);  // mem:pelisse
+  }
+  free(E->hi);  // mem:galloon
+  free(E->lo);  // mem:hackbut
+  free(E->t);   // mem:inkhorn
+}
+
+/* Reads a whole line into `*line`, growing it as needed.
+ * Returns 0 at the end of the file. */
+static int read_line(FILE *fp, char **line, size_t *size)
+{
+  size_t len = 0;
+  for (;;) {
+    if (*line == NULL || len + 1 >= *size)
+      *line = realloc(*line, *size = (*line == NULL) ? LINE_LENGTH : 2 * *size);  // mem:ashlering
+    if (!fgets(*line + len, *size - len, fp))
+      return len > 0;
+    len += strlen(*line + len);
+    if (len > 0 && (*line)[len - 1] == '\n')
+      return 1;
+  }
+}
+
+/* Reads the CSV output of the simulator, picking out the time and the node columns.
+ * Returns 0 if the file is missing or malformed. */
+static int read_csv(const Configuration *C, const char *csv, Wave *W)
+{
+  char *line = NULL;
+  size_t size = 0;
+  int *column = NULL, columns = 0, mem = 0, ok = 0;
+  FILE *fp = fopen(csv, "r");
+
+  W->length = 0;
+  W->t = NULL;
+  W->x = calloc(C->num_nodes, sizeof *W->x);  // mem:quillwort
+  if (fp == NULL || !read_line(fp, &line, &size))
+    goto cleanup;
+  /* which column is which node */
+  column = malloc(C->num_nodes * sizeof *column);  // mem:tanrec
+  for (int k = 0; C->num_nodes > k; ++k)
+    column[k] = -1;
+  for (char *name = strtok(line, ",\r\n"); name; name = strtok(NULL, ",\r\n"), ++columns) {
+    while (*name == ' ' || *name == '"')
+      ++name;
+    for (char *end = name + strlen(name); end > name && (end[-1] == ' ' || end[-1] == '"');)
+      *--end = '\0';
+    for (int k = 0; C->num_nodes > k; ++k)
+      if (column[k] == -1 && strcasecmp(name, C->nodes[k].name) == 0)
+        column[k] = columns;
+  }
+  for (int k = 0; C->num_nodes > k; ++k) {
+    if (column[k] == -1) {
+      fprintf(stderr, "malt: Node %s is not in the simulator output %s\n", C->nodes[k].name, csv);
+      goto cleanup;
+    }
+  }
+  /* values */
+  double *row = malloc(columns * sizeof *row);  // mem:bywoner
+  while (read_line(fp, &line, &size)) {
+    char *p = line, *end;
+    int c;
+    for (c = 0; columns > c; ++c, p = end + (*end == ',')) {
+      row[c] = strtod(p, &end);
+      if (end == p)
+        break;
+    }
+    if (c < columns)
+      continue;  // blank or malformed line
+    if (W->length == mem) {
+      mem = mem ? 2 * mem : 1024;
+      W->t = realloc(W->t, mem * sizeof *W->t);  // mem:jointress
+      for (int k = 0; C->num_nodes > k; ++k)
+        W->x[k] = realloc(W->x[k], mem * sizeof *W->x[k]);  // mem:kelpie
+    }
+    W->t[W->length] = row[0];
+    for (int k = 0; C->num_nodes > k; ++k)
+      W->x[k][W->length] = row[column[k]];
+    ++W->length;
+  }
+  free(row);  // mem:bywoner
+  ok = (W->length > 1);
+cleanup:
+  if (fp)
+    fclose(fp);
+  free(column);  // mem:tanrec
+  free(line);    // mem:ashlering
+  return ok;
+}
+
+/* Reads the envelope file written by define (in rawfile format, variables hi<n> and lo<n>).
+ * Returns 0 if the file is missing or malformed. */
+static int read_envelope(const Configuration *C, Envelope *E)
+{
+  char *line = NULL;
+  size_t size = 0;
+  int vars = 0, ok = 0, *node = NULL;
+  FILE *fp = fopen(C->file_names.envelope, "r");
+
+  E->length = 0;
+  E->t = NULL;
+  E->hi = calloc(C->num_nodes, sizeof *E->hi);  // mem:galloon
+  E->lo = calloc(C->num_nodes, sizeof *E->lo);  // mem:hackbut
+  if (fp == NULL)
+    goto cleanup;
+  do {
+    if (!read_line(fp, &line, &size))
+      goto cleanup;
+    if (!strncmp("No. Variables:", line, 14))
+      sscanf(line, "No. Variables:%d", &vars);
+    else if (!strncmp("No. Points:", line, 11))
+      sscanf(line, "No. Points:%d", &E->length);
+  } while (strncmp("Variables:", line, 10));
+  if (vars != 1 + 2 * C->num_nodes || E->length < 1)
+    goto cleanup;
+  E->t = malloc(E->length * sizeof *E->t);  // mem:inkhorn
+  for (int k = 0; C->num_nodes > k; ++k) {
+    E->hi[k] = malloc(E->length * sizeof *E->hi[k]);  // mem:orpiment
+    E->lo[k] = malloc(E->length * sizeof *E->lo[k]);  // mem:pelisse
+  }
+  /* variable v is hi (or lo) of node node[v] */
+  node = malloc(vars * sizeof *node);  // mem:lathen
+  char which[4];
+  if (!read_line(fp, &line, &size))  // time
+    goto cleanup;
+  for (int v = 1; vars > v; ++v) {
+    if (!read_line(fp, &line, &size) || sscanf(line, "%*d %2s%d", which, &node[v]) != 2 ||
+        node[v] < 0 || node[v] >= C->num_nodes)
+      goto cleanup;
+    if (which[0] == 'l')
+      node[v] = -1 - node[v];  // lo is negative
+  }
+  do {
+    if (!read_line(fp, &line, &size))
+      goto cleanup;
+  } while (strncmp("Values:", line, 7));
+  /* define writes fewer points than it says (the last dt of the envelope is left off) */
+  int j;
+  for (j = 0; E->length > j; ++j) {
+    if (!read_line(fp, &line, &size) || sscanf(line, "%*d %lf", &E->t[j]) != 1)
+      break;
+    for (int v = 1; vars > v; ++v) {
+      if (!read_line(fp, &line, &size))
+        goto cleanup;
+      if (node[v] >= 0)
+        E->hi[node[v]][j] = atof(line);
+      else
+        E->lo[-1 - node[v]][j] = atof(line);
+    }
+  }
+  E->length = j;
+  ok = (j > 0);
+cleanup:
+  if (fp)
+    fclose(fp);
+  free(node);  // mem:lathen
+  free(line);  // mem:ashlering
+  return ok;
+}
+
+/* Writes the deck for one simulation: the parameter values and then the circuit.
+ * `param[1..C->num_params_all]` are the physical parameter values. */
+static void write_deck(const Configuration *C, const char *deck, const double *param)
+{
+  FILE *fp;
+
+  if ((fp = fopen(deck, "w")) == NULL) {
+    fprintf(stderr, "malt: Cannot write to the '%s' file", deck);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(fp, "* %s\n", deck);
+  for (int i = 0; C->num_params_all > i; ++i)
+    fprintf(fp, ".param %s=%.10g\n", C->params[i].name, param[i + 1]);
+  if (C->file_names.param)
+    fprintf(fp, ".include %s\n", C->file_names.param);
+  fprintf(fp, ".include %s\n", C->file_names.circuit);
+  fclose(fp);
+}
+
+/* Runs the simulator on `deck`, writing the waveforms to `csv`.
+ * Returns 1 if the simulator exited successfully. */
+static int run_sim(const Configuration *C, const char *deck, const char *csv)
+{
+  pid_t sim = fork();
+  if (0 == sim) {
+    freopen("/dev/null", "r", stdin);
+    freopen(C->options.spice_verbose ? ".verbage" : "/dev/null", "w", stdout);
+    execlp(C->options.spice_call_name, C->options.spice_call_name, "-o", csv, deck, (char *)NULL);
+    perror("malt: execlp");
+    fprintf(stderr, "malt: (called %s)\n", C->options.spice_call_name);
+    _exit(EXIT_FAILURE);
+  }
+  if (sim == -1) {
+    perror("malt: fork");
+    return 0;
+  }
+  int status;
+  if (waitpid(sim, &status, 0) == -1)
+    return 0;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* Returns the value of a waveform at time `t`, interpolating linearly and advancing `*i` so that
+ * increasing times can be looked up in one pass. */
+static double wave_at(const Wave *W, int k, double t, int *i)
+{
+  while (*i + 2 < W->length && W->t[*i + 1] <= t)
+    ++*i;
+  double t0 = W->t[*i], t1 = W->t[*i + 1];
+  if (t <= t0 || t1 <= t0)
+    return W->x[k][*i];
+  if (t >= t1)
+    return W->x[k][*i + 1];
+  return W->x[k][*i] + (W->x[k][*i + 1] - W->x[k][*i]) * (t - t0) / (t1 - t0);
+}
+
+/* Simulates the parameter values `param[..]` and checks the waveforms against the envelope.
+ * Returns 1 if the circuit fails (or the simulation does), as in malt.passfail. */
+static int passfail(const Configuration *C, const Envelope *E, const char *call,
+                    const double *param)
+{
+  char *deck = resprintf(NULL, "%s.cir", call);  // mem:mistal
+  char *csv = resprintf(NULL, "%s.csv", call);    // mem:nuncheon
+  Wave W = {0, NULL, NULL};
+  int failed = 1;
+
+  write_deck(C, deck, param);
+  if (run_sim(C, deck, csv) && read_csv(C, csv, &W)) {
+    failed = 0;
+    for (int k = 0; C->num_nodes > k && !failed; ++k) {
+      for (int j = 0, i = 0; E->length > j && !failed; ++j) {
+        double x = wave_at(&W, k, E->t[j], &i);
+        failed = (x > E->hi[k][j] || x < E->lo[k][j]);
+      }
+    }
+  }
+  wave_free(C, &W);
+  unlink(deck);
+  unlink(csv);
+  free(deck);  // mem:mistal
+  free(csv);   // mem:nuncheon
+  return failed;
+}
+
+/* Moves the search point one step in (sign > 0) or out (sign < 0), in linear or log space. */
+static void step(int n, const int *pl, double *param, const double *delta, const double *deltal,
+                 int sign)
+{
+  for (int i = 0; n > i; ++i) {
+    if (pl[i])
+      param[i] = (sign > 0) ? param[i] * deltal[i] : param[i] / deltal[i];
+    else
+      param[i] += sign * delta[i];
+  }
+}
+
+/* Warns about what the WRspice scripts do that this backend cannot. */
+void cli_prepare(const Configuration *C)
+{
+  if (C->file_names.passf) {
+    warn("The %s backend ignores the passfail file %s\n", C->options.backend,
+         C->file_names.passf);
+  }
+}
+
+/* Does what malt.binsearch does, writing the same .return file, in a subprocess.
+ *
+ * For define (`pc` NULL), simulates the nominal parameter values instead, leaving the waveforms in
+ * <command>.nom.csv for cli_read_nominal.
+ *
+ * Returns the PID of the subprocess.
+ */
+pid_t cli_start(const Configuration *C, double accuracy, double *pc, double *po, int dashc,
+                const char *call, const char *returnn)
+{
+  int n = C->num_params_all + 1;  // element 0 counts down the binary search
+  double *param = malloc(n * sizeof *param);  // mem:quodlibet
+
+  if (C->function == 'd') {
+    for (int i = 0; C->num_params_all > i; ++i)
+      param[i + 1] = C->params[i].nominal;
+  }
+  fflush(stdout);
+  pid_t child = fork();
+  if (child != 0) {
+    if (child == -1)
+      perror("malt: fork");
+    free(param);  // mem:quodlibet
+    return child;
+  }
+
+  /* child */
+  if (C->function == 'd') {
+    char *csv = resprintf(NULL, "%s.nom.csv", C->command);  // mem:ramekin
+    write_deck(C, call, param);
+    int ok = run_sim(C, call, csv);
+    free(csv);    // mem:ramekin
+    free(param);  // mem:quodlibet
+    _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  Envelope E;
+  if (!read_envelope(C, &E)) {
+    fprintf(stderr, "malt: Cannot read the envelope file %s\n", C->file_names.envelope);
+    _exit(EXIT_FAILURE);
+  }
+  double *vpc = malloc(n * sizeof *vpc);        // mem:sackbut
+  double *vpo = malloc(n * sizeof *vpo);        // mem:tabard
+  double *delta = malloc(n * sizeof *delta);    // mem:umbrel
+  double *deltal = malloc(n * sizeof *deltal);  // mem:varlet
+  int *pl = malloc(n * sizeof *pl);             // mem:wimple
+  /* the same vectors as the .call file of the WRspice backend */
+  vpc[0] = 0.0;
+  vpo[0] = accuracy;
+  pl[0] = 0;
+  for (int i = 0; C->num_params_all > i; ++i) {
+    if (i < C->num_params) {
+      vpc[i + 1] = physspace(pc[i], C, i);
+      vpo[i + 1] = physspace(po[i], C, i);
+    } else if (i < C->num_params + C->num_params_corn) {
+      vpc[i + 1] = vpo[i + 1] = physspace(pc[i], C, i);
+    } else if (C->params[i].load) {
+      vpc[i + 1] = physspace(malt_at(pc, C, i), C, i);
+      vpo[i + 1] = physspace(malt_at(po, C, i), C, i);
+    } else {
+      vpc[i + 1] = vpo[i + 1] = C->params[i].nominal;
+    }
+    pl[i + 1] = C->params[i].logs;
+  }
+
+  FILE *fp = fopen(returnn, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "malt: Cannot write to the '%s' file", returnn);
+    _exit(EXIT_FAILURE);
+  }
+  /* check inner point...except for corners */
+  int failed = dashc ? 0 : passfail(C, &E, call, vpc);
+  fprintf(fp, "%d\n", failed);
+  /* check outer point, unless this is a point-check */
+  if (failed == 0 && vpo[0] != 0.0) {
+    memcpy(param, vpo, n * sizeof *param);
+    if (passfail(C, &E, call, param)) {
+      /* find margin */
+      for (int i = 0; n > i; ++i) {
+        delta[i] = 0.5 * (vpo[i] - vpc[i]);
+        deltal[i] = pl[i] ? sqrt(vpo[i] / vpc[i]) : 1.0;
+      }
+      step(n, pl, param, delta, deltal, -1);
+      while (delta[0] > 1) {
+        for (int i = 0; n > i; ++i) {
+          deltal[i] = sqrt(deltal[i]);
+          delta[i] *= 0.5;
+        }
+        step(n, pl, param, delta, deltal, passfail(C, &E, call, param) ? -1 : 1);
+      }
+    }
+    for (int i = 0; n > i; ++i)
+      fprintf(fp, "%.10g ", param[i]);
+    fprintf(fp, "\n");
+  }
+  envelope_free(C, &E);
+  free(vpc);     // mem:sackbut
+  free(vpo);     // mem:tabard
+  free(delta);   // mem:umbrel
+  free(deltal);  // mem:varlet
+  free(pl);      // mem:wimple
+  free(param);   // mem:quodlibet
+  _exit(fclose(fp) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* Reads the waveforms of the nominal simulation for define, as readData does for WRspice. */
+int cli_read_nominal(Configuration *C, Data *D, int *scramble)
+{
+  char *csv = resprintf(NULL, "%s.nom.csv", C->command);  // mem:yarrow
+  Wave W;
+  int ret = read_csv(C, csv, &W);
+
+  if (!ret) {
+    fprintf(stderr, "malt: Can not read %s\n", csv);
+  } else {
+    /* the columns are already in the order of C->nodes */
+    D->length = W.length;
+    D->t = W.t;
+    D->x = W.x;
+    D->upper = malloc(C->num_nodes * sizeof *D->upper);  // mem:cordwain
+    D->lower = malloc(C->num_nodes * sizeof *D->lower);  // mem:fennish
+    for (int k = 0; C->num_nodes > k; ++k) {
+      scramble[k] = k;
+      D->upper[k] = calloc(D->length, sizeof **D->upper);  // mem:zibet
+      D->lower[k] = calloc(D->length, sizeof **D->lower);  // mem:brattice
+    }
+    D->tstep = D->t[1] - D->t[0];
+    W.t = NULL;
+    W.x = NULL;
+  }
+  wave_free(C, &W);
+  free(csv);  // mem:yarrow
+  return ret;
+}
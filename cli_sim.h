@@ -0,0 +1,15 @@
+// vi: ts=2 sts=2 sw=2 et tw=100
+
+#ifndef CLI_SIM
+#define CLI_SIM
+
+#include "config.h"
+#include "define.h"
+#include <sys/types.h>
+
+void cli_prepare(const Configuration *C);
+pid_t cli_start(const Configuration *C, double accuracy, double *pc, double *po, int dashc,
+                const char *call, const char *returnn);
+int cli_read_nominal(Configuration *C, Data *D, int *scramble);
+
+#endif
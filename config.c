@@ -5,22 +5,41 @@
 // - Keep track of initialized status of fields in Builder, don't print the uninitialized ones by
 // value (print examples instead)
 // - implement units field for dt and dx
-// - separate [corners]
 
 #include "config.h"
+#include "call_spice.h"
 #include "list.h"
 #include "malt.h"
+#include "numerical.h"
 #include "toml.h"
 #include <assert.h>
 #include <ctype.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h> /* for strcasecmp */
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+/* [yield] moments, indexed by options.y_moments + 1 */
+static const char *const moments_names[] = {"auto", "recompute", "store"};
+/* [yield] mesh, indexed by options.y_mesh + 1 */
+static const char *const mesh_names[] = {"auto", "corners", "orthants"};
+/* [yield] store, indexed by options.y_store */
+static const char *const store_names[] = {"memory", "file"};
+/* [yield] anneal, indexed by options.y_anneal */
+static const char *const anneal_names[] = {"fixed", "adaptive"};
+/* [yield] surrogate, indexed by options.y_surrogate */
+static const char *const surrogate_names[] = {"off", "skip", "verify"};
+/* [montecarlo] method, indexed by options.mc_method */
+static const char *const mc_method_names[] = {"plain", "importance", "directional"};
+
+/* range of the principal components in sigma, wide enough never to be the bound of a search */
+#define PC_RANGE 1000.0
+
 static const Param PARAM_DEFAULT = {
     .name = NULL,
     .nominal = 1,
@@ -36,8 +55,16 @@ static const Param PARAM_DEFAULT = {
     .include = 1,
     .logs = 1,
     .corners = 0,
+    .load = NULL,
 };
 
+/* A correlation coefficient between two parameters, from [correlations] */
+typedef struct correlation {
+  const char *a;
+  const char *b;
+  double rho;
+} Correlation;
+
 typedef struct builder {
   int function;
   FILE *log;
@@ -64,6 +91,9 @@ typedef struct builder {
 
   int num_2D;
   _2D *_2D;
+
+  int num_corrs;
+  Correlation *corrs;
 } Builder;
 
 static void builder_debug(const Builder *B, FILE *fp)
@@ -112,8 +142,37 @@ static void builder_debug(const Builder *B, FILE *fp)
   comment("Simulator options");
   section("simulator");
   key_val("max_subprocesses", "%d", B->options.max_subprocesses);
-  key_val("command", "'%s'", B->options.spice_call_name);
+  comment("'wrspice', or 'cli' to run `command -o out.csv deck.cir` (e.g. josim-cli) per point");
+  key_val("backend", "'%s'", B->options.backend);
+  comment("(the backend's own when left out: wrspice, or josim-cli for 'cli')");
+  key_val("command", "'%s'",
+          B->options.spice_call_name ? B->options.spice_call_name
+                                     : find_backend(B->options.backend)->command);
   key_val("verbose", "%s", B->options.spice_verbose ? "true" : "false");
+  comment("simulator slots shared fairly by all malt runs on this host (0 = no limit)");
+  key_val("host_slots", "%d", B->options.host_slots);
+  key_val("slot_pool", "'%s'", B->options.slot_pool);
+  comment("stop cleanly before the next batch would run over (0 = no limit)");
+  key_val("max_simulations", "%d", B->options.max_simulations);
+  if (B->options.deadline > 0.0) {
+    char when[32];
+    time_t deadline = B->options.deadline;
+    struct tm tm;
+    strftime(when, sizeof when, "%Y-%m-%dT%H:%M:%S", localtime_r(&deadline, &tm));
+    key_val("deadline", "%s", when);
+  } else {
+    comment("deadline = 07:00:00  # the next 07:00, or a full date-time");
+  }
+
+  brk();
+  comment("Corner parameters");
+  section("corners");
+  comment("take each search at the worst corners that probes of the 1D margins find, not at all");
+  comment("2^K of them (needed for more than 30 corner parameters)");
+  key_val("screen", "%s", B->options.c_screen ? "true" : "false");
+  comment("every this many searches are taken at all corners anyway, to catch the corners that");
+  comment("the probes miss (0 = never; never for more than 16 corner parameters)");
+  key_val("audit", "%d", B->options.c_audit);
 
   brk();
   comment("Default envelope settings for all nodes");
@@ -155,6 +214,18 @@ static void builder_debug(const Builder *B, FILE *fp)
     fprintf(fp, " }\n");
   }
 
+  brk();
+  comment("Correlation coefficients of the included normal parameters in malt space (i.e. of");
+  comment("their logs if logs = true); they are analyzed as their principal components instead");
+  comment("Example:");
+  comment("'XJ1' = { 'XJ2' = 0.8, 'XL1' = -0.3 }");
+  section("correlations");
+  comment("percentage of their variance kept by the strongest principal components");
+  key_val("variance", "%g", B->options.pc_variance);
+  for (int i = 0; i < B->num_corrs; ++i) {
+    fprintf(fp, "'%s' = { '%s' = %g }\n", B->corrs[i].a, B->corrs[i].b, B->corrs[i].rho);
+  }
+
   brk();
   comment("Options for 2D margin analysis");
   section("xy");
@@ -205,12 +276,65 @@ static void builder_debug(const Builder *B, FILE *fp)
   key_val("max_mem_k", "%d", B->options.y_max_mem_k);
   key_val("accuracy", "%g", B->options.y_accuracy);
   key_val("print_every", "%d", B->options.y_print_every);
+  comment("coarse binsearch accuracy for the first annealing step (0 = binsearch_accuracy)");
+  key_val("binsearch_start", "%g", B->options.y_binsearch_start);
+  comment("keep simplex volumes and moments in memory: \"store\", \"recompute\" or \"auto\"");
+  key_val("moments", "'%s'", moments_names[B->options.y_moments + 1]);
+  comment("simplex and moment pages kept in \"memory\", or in a \"file\" of _malt that is mapped");
+  comment("(then max_mem_k limits the rest only)");
+  key_val("store", "'%s'", store_names[B->options.y_store]);
+  comment("first mesh: \"corners\" (2^N corner margins), \"orthants\" (none) or \"auto\"");
+  key_val("mesh", "'%s'", mesh_names[B->options.y_mesh + 1]);
+  comment("simplexes split per round of simulations (0 = one per free simulator slot)");
+  key_val("batch", "%d", B->options.y_batch);
+  comment("threads of the passes over all the simplexes (0 = one per processor)");
+  key_val("threads", "%d", B->options.y_threads);
+  comment("also stop once the standard error of 1-yield is at most this (0 = not)");
+  key_val("stderr", "%g", B->options.y_stderr);
+  comment("and/or once its 95%% confidence interval is within this percentage (0 = not)");
+  key_val("confidence", "%g", B->options.y_confidence);
+  comment("annealing: \"fixed\" schedule, or \"adaptive\" to skip it once within accuracy");
+  key_val("anneal", "'%s'", anneal_names[B->options.y_anneal]);
+  comment("margins predicted from their neighbors: \"off\", \"skip\" their searches, or");
+  comment("\"verify\" each with one point-check");
+  key_val("surrogate", "'%s'", surrogate_names[B->options.y_surrogate]);
+  comment("predict only when the 95%% band of a gauss integral is within this percentage of");
+  comment("1-Yield");
+  key_val("surrogate_tol", "%g", B->options.y_surrogate_tol);
+  comment("freeze the parameters that hardly limit the circuit at nominal, while the 1-Yield that");
+  comment("this misses is estimated within this percentage (0 = not)");
+  key_val("screen", "%g", B->options.y_screen);
+  comment("random boundary searches that also rank the parameters for that");
+  key_val("screen_directions", "%d", B->options.y_screen_dirs);
 
   brk();
   comment("Options for parameter optimization");
   section("optimize");
   key_val("min_iter", "%d", B->options.o_min_iter);
   key_val("max_mem_k", "%d", B->options.o_max_mem_k);
+  comment("coarse binsearch accuracy, halved as the radius converges (0 = binsearch_accuracy)");
+  key_val("binsearch_start", "%g", B->options.o_binsearch_start);
+  comment("directions of the yield of the final hull, found without simulations (0 = none)");
+  key_val("yield_directions", "%d", B->options.o_yield_dirs);
+  comment("threads of that yield (0 = one per processor)");
+  key_val("threads", "%d", B->options.o_threads);
+  comment("sigma by which to move each binding nom_min/nom_max, for the yield change (0 = not)");
+  key_val("nom_step", "%g", B->options.o_nom_step);
+  comment("freeze the parameters that hardly limit the circuit, as in [yield] (0 = not)");
+  key_val("screen", "%g", B->options.o_screen);
+  key_val("screen_directions", "%d", B->options.o_screen_dirs);
+
+  brk();
+  comment("Options for Monte Carlo yield");
+  section("montecarlo");
+  key_val("samples", "%d", B->options.mc_samples);
+  comment("\"plain\", \"importance\" sampling about the boundary points of the margins, or");
+  comment("\"directional\" boundary searches along quasi-random directions");
+  key_val("method", "'%s'", mc_method_names[B->options.mc_method]);
+  comment("the same seed draws the same samples, however many simulators run at once");
+  key_val("seed", "%d", B->options.mc_seed);
+  comment("stop once the 95%% confidence interval of 1-yield is within this percentage (0 = not)");
+  key_val("confidence", "%g", B->options.mc_confidence);
 }
 
 static void _2D_drop(_2D *ptr)
@@ -225,6 +349,32 @@ static void param_drop(Param *ptr)
 {
   free((void *)ptr->name);  // mem:reminiscer
   ptr->name = NULL;
+  free(ptr->load);  // mem:upgaze
+  ptr->load = NULL;
+}
+
+/* Grows a parameter array to `num` parameters, in read_parameters and for the principal
+ * components alike. */
+static Param *params_grow(Param *params, int num)
+{
+  return realloc(params, num * sizeof *params);  // mem:restringer
+}
+
+/* A copy of a parameter name, freed by param_drop. */
+static const char *param_name(const char *name)
+{
+  return strdup(name);  // mem:reminiscer
+}
+
+static void correlations_drop(Builder *B)
+{
+  for (int c = 0; c < B->num_corrs; ++c) {
+    free((void *)B->corrs[c].a);  // mem:yokelish
+    free((void *)B->corrs[c].b);  // mem:unfoaled
+  }
+  free(B->corrs);  // mem:sandbur
+  B->corrs = NULL;
+  B->num_corrs = 0;
 }
 
 static void node_drop(Node *nptr)
@@ -243,8 +393,11 @@ void freeConfiguration(Configuration *C)
   free(C->file_names.plot);                  // mem:federalizes
   free(C->file_names.iter);                  // mem:myrcene
   free(C->file_names.pname);                 // mem:physnomy
+  free(C->file_names.sched);                 // mem:tolbooth
   free(C->extensions.which_trace);           // mem:intratubal
   free((void *)C->options.spice_call_name);  // mem:descendentalism
+  free((void *)C->options.slot_pool);        // mem:overlords
+  free((void *)C->options.backend);          // mem:mesoblast
 
   fclose(C->log);
 
@@ -285,6 +438,7 @@ static void builder_init(Builder *C, const Args *args, FILE *log)
   C->file_names.plot = NULL;
   C->file_names.iter = NULL;
   C->file_names.pname = NULL;
+  C->file_names.sched = NULL;
   /* node defaults */
   C->node_defaults.name = NULL;
   C->node_defaults.units = 'V';
@@ -297,6 +451,8 @@ static void builder_init(Builder *C, const Args *args, FILE *log)
   C->num_nodes = 0;
   C->num_params_all = 0;
   C->num_2D = 0;
+  C->corrs = NULL;
+  C->num_corrs = 0;
   /* extensions */
   C->extensions.circuit = ".cir";
   C->extensions.param = ".param";
@@ -308,9 +464,16 @@ static void builder_init(Builder *C, const Args *args, FILE *log)
   C->extensions.which_trace = malloc(LINE_LENGTH);  // mem:intratubal
   /* options */
   C->options.binsearch_accuracy = 0.1;
-  C->options.spice_call_name = strdup("wrspice");  // mem:descendentalism
+  C->options.spice_call_name = NULL;      // that of the backend, unless [simulator] command is set
+  C->options.backend = strdup("wrspice");  // mem:mesoblast
   C->options.spice_verbose = 0;
   C->options.max_subprocesses = 0;  // default # jobs: unlimited
+  C->options.host_slots = 0;        // no host-wide limit
+  C->options.slot_pool = strdup("/dev/shm/malt-slots");  // mem:overlords
+  C->options.max_simulations = 0;   // unlimited
+  C->options.deadline = 0.0;        // none
+  C->options.c_screen = 0;          // all corners
+  C->options.c_audit = 16;
   C->options.print_terminal = 1;
   /* options for define */
   C->options.d_simulate = 1;
@@ -326,9 +489,35 @@ static void builder_init(Builder *C, const Args *args, FILE *log)
   C->options.y_max_mem_k = 4194304;
   C->options.y_accuracy = 10;
   C->options.y_print_every = 0;
+  C->options.y_binsearch_start = 0.0;
+  C->options.y_moments = -1;  // auto
+  C->options.y_store = 0;     // memory
+  C->options.y_batch = 0;     // one per slot
+  C->options.y_mesh = -1;     // auto
+  C->options.y_threads = 0;   // one per processor
+  C->options.y_stderr = 0.0;
+  C->options.y_confidence = 0.0;
+  C->options.y_anneal = 0;  // fixed
+  C->options.y_surrogate = 0;  // off
+  C->options.y_surrogate_tol = 10.0;
+  C->options.y_screen = 0.0;
+  C->options.y_screen_dirs = 0;
   /* options for optimize */
   C->options.o_min_iter = 100;
   C->options.o_max_mem_k = 4194304;
+  C->options.o_binsearch_start = 0.0;
+  C->options.o_yield_dirs = 65536;
+  C->options.o_threads = 0;  // one per processor
+  C->options.o_nom_step = 0.0;
+  C->options.o_screen = 0.0;
+  C->options.o_screen_dirs = 0;
+  /* options for montecarlo */
+  C->options.mc_samples = 10000;
+  C->options.mc_method = 0;  // plain
+  C->options.mc_seed = 1;
+  C->options.mc_confidence = 0.0;
+  /* options for correlated parameters */
+  C->options.pc_variance = 100.0;
 }
 
 /* Reads a boolean from the table `values`, allowing either a TOML boolean or
@@ -390,6 +579,98 @@ __attribute__((nonnull)) static int read_a_string(const char **dest, toml_table_
   }
 }
 
+/* Reads a string from the table `values` that has to be one of the `num` names[..], the choices of
+ * option `key` of [table].
+ * Returns 1 and stores the index of the name in *dest if present; returns 0 otherwise. */
+__attribute__((nonnull)) static int read_a_name(Builder *C, int *dest, toml_table_t *values,
+                                                const char *table, const char *key,
+                                                const char *const names[], int num)
+{
+  const char *name;
+  if (!read_a_string(&name, values, key)) {
+    return 0;
+  }
+  int i;
+  for (i = 0; num > i && strcmp(name, names[i]); ++i)
+    ;
+  if (num == i) {
+    char choices[128] = "";
+    for (int j = 0; num > j; ++j) {
+      size_t len = strlen(choices);
+      snprintf(&choices[len], sizeof choices - len, "%s\"%s\"",
+               j == 0 ? "" : (j == num - 1 ? " or " : ", "), names[j]);
+    }
+    error("Unknown %s %s '%s' (use %s)\n", table, key, name, choices);
+  }
+  free((char *)name);  // mem:timetaker
+  *dest = i;
+  return 1;
+}
+
+/* read_a_name of the option `key` of the table `table`, whose choices are the array `names` */
+#define READ_A_NAME(dest, table, key, names) \
+  read_a_name(C, dest, table, #table, key, names, sizeof names / sizeof *names)
+
+/* Returns the number of days from 1970-01-01 to the given date of the proleptic Gregorian calendar.
+ */
+static long days_from_civil(long y, int m, int d)
+{
+  y -= m <= 2;
+  long era = (y >= 0 ? y : y - 399) / 400;
+  long yoe = y - era * 400;
+  long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+/* Reads a TOML date-time or time from the table `values` as seconds since the epoch.
+ * A local date-time is taken in the local time zone, and a local time by itself means the next
+ * time the clock reads that.
+ * Returns 1 and stores the result in *dest if present; returns 0 otherwise. */
+__attribute__((nonnull)) static int read_a_time(double *dest, toml_table_t *values,
+                                                const char *key)
+{
+  toml_datum_t value = toml_timestamp_in(values, key);  // mem:steeplechasing
+  if (!value.ok) {
+    return 0;
+  }
+  toml_timestamp_t *ts = value.u.ts;
+  time_t now = time(NULL), when;
+  struct tm tm;
+
+  localtime_r(&now, &tm);
+  if (ts->year) {
+    tm.tm_year = *ts->year - 1900;
+    tm.tm_mon = *ts->month - 1;
+    tm.tm_mday = *ts->day;
+  }
+  tm.tm_hour = ts->hour ? *ts->hour : 0;
+  tm.tm_min = ts->minute ? *ts->minute : 0;
+  tm.tm_sec = ts->second ? *ts->second : 0;
+  if (ts->z) {
+    /* offset date-time: do the arithmetic in UTC */
+    long offset = 0;
+    if (ts->z[0] == '+' || ts->z[0] == '-') {
+      offset = 60 * (60 * atol(&ts->z[1]) + (ts->z[3] == ':' ? atol(&ts->z[4]) : 0));
+      offset = (ts->z[0] == '-') ? -offset : offset;
+    }
+    when = 86400 * days_from_civil(tm.tm_year + 1900L, tm.tm_mon + 1, tm.tm_mday) +
+           3600 * tm.tm_hour + 60 * tm.tm_min + tm.tm_sec - offset;
+  } else {
+    tm.tm_isdst = -1;
+    when = mktime(&tm);
+    if (!ts->year && when <= now) {
+      /* that time has passed today, so it means tomorrow */
+      ++tm.tm_mday;
+      tm.tm_isdst = -1;
+      when = mktime(&tm);
+    }
+  }
+  free(ts);  // mem:steeplechasing
+  *dest = (double)when;
+  return 1;
+}
+
 /* Validates that this table contains no keys except for the ones passed.
  * Terminate the argument list with NULL.
  * Returns false if the table contains keys other than those passed as arguments. */
@@ -434,11 +715,31 @@ static bool keys_ok(Builder *C, toml_table_t *t, ...)
  * Returns 0 if the section is not present or incomplete and 1 otherwise. */
 static int read_simulator(Builder *C, toml_table_t *t)
 {
-  SCHEMA(simulator, "max_subprocesses", "command", "verbose");
+  SCHEMA(simulator, "max_subprocesses", "backend", "command", "verbose", "host_slots", "slot_pool",
+         "max_simulations", "deadline");
   int n = 0;
   n += read_an_int(&C->options.max_subprocesses, simulator, "max_subprocesses");
+  n += read_an_int(&C->options.max_simulations, simulator, "max_simulations");
+  n += read_a_time(&C->options.deadline, simulator, "deadline");
+  n += read_a_string(&C->options.backend, simulator, "backend");
+  if (!find_backend(C->options.backend)) {
+    error("Unknown simulator backend '%s'\n", C->options.backend);
+  }
   n += read_a_string(&C->options.spice_call_name, simulator, "command");
   n += read_a_bool(&C->options.spice_verbose, simulator, "verbose");
+  n += read_an_int(&C->options.host_slots, simulator, "host_slots");
+  n += read_a_string(&C->options.slot_pool, simulator, "slot_pool");
+  return n;
+}
+
+/* Parse the [corners] options section of this file.
+ * Returns the number of key-value pairs successfully converted. */
+static int read_corners_opts(Builder *C, toml_table_t *t)
+{
+  SCHEMA(corners, "screen", "audit");
+  int n = 0;
+  n += read_a_bool(&C->options.c_screen, corners, "screen");
+  n += read_an_int(&C->options.c_audit, corners, "audit");
   return n;
 }
 
@@ -543,7 +844,7 @@ static int read_parameters(Builder *C, toml_table_t *t)
     }
     if (!match) {
       // grow C->params by 1 (slow but whatever)
-      C->params = realloc(C->params, (++C->num_params_all) * sizeof *C->params);  // mem:restringer
+      C->params = params_grow(C->params, ++C->num_params_all);
       C->params[n] = PARAM_DEFAULT;
     }
 
@@ -551,7 +852,7 @@ static int read_parameters(Builder *C, toml_table_t *t)
     //free(C->params[n].name);
     C->params[n] = PARAM_DEFAULT;
     // parameter name:
-    C->params[n].name = strdup(parameter);  // mem:reminiscer
+    C->params[n].name = param_name(parameter);
 
     // nominal-only parameters are simply numeric, and never included in analysis
     toml_datum_t nominal = toml_double_in(parameters, parameter);
@@ -608,6 +909,61 @@ static int read_parameters(Builder *C, toml_table_t *t)
   return i;
 }
 
+/* Reads the [correlations] table from the TOML file, if present: an inline table of correlation
+ * coefficients per parameter, and the percentage of the variance to keep.
+ * Returns the number of correlation coefficients successfully read. */
+static int read_correlations(Builder *C, toml_table_t *t)
+{
+  toml_table_t *correlations = toml_table_in(t, "correlations");
+  if (!correlations) {
+    return 0;
+  }
+  int n = 0;
+  for (int i = 0;; ++i) {
+    const char *a = toml_key_in(correlations, i);
+    if (!a)
+      break;
+    if (!strcmp(a, "variance")) {
+      if (!read_a_double(&C->options.pc_variance, correlations, "variance") ||
+          !(C->options.pc_variance > 0.0 && C->options.pc_variance <= 100.0)) {
+        error("[correlations] variance must be a percentage above 0, up to 100\n");
+      }
+      continue;
+    }
+    toml_table_t *with = toml_table_in(correlations, a);
+    if (!with) {
+      error("[correlations.%s] is not a table\n", a);
+    }
+    for (int j = 0;; ++j) {
+      const char *b = toml_key_in(with, j);
+      if (!b)
+        break;
+      double rho;
+      if (!read_a_double(&rho, with, b) || !(rho >= -1.0 && rho <= 1.0)) {
+        error("The correlation of '%s' with '%s' must be a number from -1 to 1\n", a, b);
+      }
+      if (!strcmp(a, b)) {
+        error("Parameter '%s' cannot be correlated with itself\n", a);
+      }
+      // the same pair in another file overwrites it
+      int c;
+      for (c = 0; c < C->num_corrs; ++c) {
+        if ((!strcmp(C->corrs[c].a, a) && !strcmp(C->corrs[c].b, b)) ||
+            (!strcmp(C->corrs[c].a, b) && !strcmp(C->corrs[c].b, a)))
+          break;
+      }
+      if (c == C->num_corrs) {
+        C->corrs = realloc(C->corrs, (++C->num_corrs) * sizeof *C->corrs);  // mem:sandbur
+        C->corrs[c].a = strdup(a);                                           // mem:yokelish
+        C->corrs[c].b = strdup(b);                                           // mem:unfoaled
+      }
+      C->corrs[c].rho = rho;
+      ++n;
+    }
+  }
+  return n;
+}
+
 /* Reads the [extensions] table containing file extensions from the TOML file, if present.
  * Returns the number of extensions successfully read. */
 static int read_extensions(Builder *C, toml_table_t *t)
@@ -639,8 +995,10 @@ static int read_define_opts(Builder *C, toml_table_t *t)
 static int read_yield_opts(Builder *C, toml_table_t *t)
 {
   SCHEMA(yield, "search_depth", "search_width", "search_steps", "max_mem_k", "accuracy",
-         "print_every");
-  int n = 0;
+         "print_every", "binsearch_start", "moments", "batch", "mesh", "threads", "stderr",
+         "confidence", "anneal", "surrogate", "surrogate_tol", "store", "screen",
+         "screen_directions");
+  int n = 0, i;
   n += read_an_int(&C->options.y_search_depth, yield, "search_depth");
   n += read_an_int(&C->options.y_search_width, yield, "search_width");
   n += read_an_int(&C->options.y_search_steps, yield, "search_steps");
@@ -650,6 +1008,26 @@ static int read_yield_opts(Builder *C, toml_table_t *t)
   n += read_a_double(&C->options.y_accuracy, yield, "accuracy");
   // TODO: check that print_every is working optimally
   n += read_an_int(&C->options.y_print_every, yield, "print_every");
+  n += read_a_double(&C->options.y_binsearch_start, yield, "binsearch_start");
+  n += read_an_int(&C->options.y_batch, yield, "batch");
+  n += read_an_int(&C->options.y_threads, yield, "threads");
+  n += read_a_double(&C->options.y_stderr, yield, "stderr");
+  n += read_a_double(&C->options.y_confidence, yield, "confidence");
+  n += READ_A_NAME(&C->options.y_anneal, yield, "anneal", anneal_names);
+  n += read_a_double(&C->options.y_surrogate_tol, yield, "surrogate_tol");
+  n += read_a_double(&C->options.y_screen, yield, "screen");
+  n += read_an_int(&C->options.y_screen_dirs, yield, "screen_directions");
+  n += READ_A_NAME(&C->options.y_surrogate, yield, "surrogate", surrogate_names);
+  /* mesh and moments are indexed from "auto", which is -1 */
+  if (READ_A_NAME(&i, yield, "mesh", mesh_names)) {
+    C->options.y_mesh = i - 1;
+    ++n;
+  }
+  if (READ_A_NAME(&i, yield, "moments", moments_names)) {
+    C->options.y_moments = i - 1;
+    ++n;
+  }
+  n += READ_A_NAME(&C->options.y_store, yield, "store", store_names);
   return n;
 }
 
@@ -657,10 +1035,30 @@ static int read_yield_opts(Builder *C, toml_table_t *t)
  * Returns the number of key-value pairs successfully converted. */
 static int read_optimize_opts(Builder *C, toml_table_t *t)
 {
-  SCHEMA(optimize, "min_iter", "max_mem_k");
+  SCHEMA(optimize, "min_iter", "max_mem_k", "binsearch_start", "yield_directions", "threads",
+         "nom_step", "screen", "screen_directions");
   int n = 0;
   n += read_an_int(&C->options.o_min_iter, optimize, "min_iter");
   n += read_an_int(&C->options.o_min_iter, optimize, "max_mem_k");
+  n += read_a_double(&C->options.o_binsearch_start, optimize, "binsearch_start");
+  n += read_an_int(&C->options.o_yield_dirs, optimize, "yield_directions");
+  n += read_an_int(&C->options.o_threads, optimize, "threads");
+  n += read_a_double(&C->options.o_nom_step, optimize, "nom_step");
+  n += read_a_double(&C->options.o_screen, optimize, "screen");
+  n += read_an_int(&C->options.o_screen_dirs, optimize, "screen_directions");
+  return n;
+}
+
+/* Reads the [montecarlo] table (Monte Carlo yield options) from the TOML file, if present.
+ * Returns the number of key-value pairs successfully converted. */
+static int read_montecarlo_opts(Builder *C, toml_table_t *t)
+{
+  SCHEMA(montecarlo, "samples", "method", "seed", "confidence");
+  int n = 0;
+  n += read_an_int(&C->options.mc_samples, montecarlo, "samples");
+  n += read_an_int(&C->options.mc_seed, montecarlo, "seed");
+  n += read_a_double(&C->options.mc_confidence, montecarlo, "confidence");
+  n += READ_A_NAME(&C->options.mc_method, montecarlo, "method", mc_method_names);
   return n;
 }
 
@@ -721,8 +1119,8 @@ static int try_parse_configuration(Builder *C, char *filename)
 
   // options:
   if (!keys_ok(C, t, "print_terminal", "binsearch_accuracy", "simulator", "nodes", "parameters",
-               "envelope", "extensions", "define", "margins", "trace", "yield", "optimize", "xy",
-               NULL)) {
+               "envelope", "extensions", "define", "margins", "trace", "yield", "optimize",
+               "montecarlo", "xy", "correlations", "corners", NULL)) {
     error("While parsing a TOML file (%s)\n", filename);
   }
   // TODO: check that print_terminal is working as intended
@@ -730,14 +1128,17 @@ static int try_parse_configuration(Builder *C, char *filename)
   read_a_double(&C->options.binsearch_accuracy, t, "binsearch_accuracy");
 
   read_simulator(C, t);
+  read_corners_opts(C, t);
   read_nodes(C, t);
   read_parameters(C, t);
+  read_correlations(C, t);
   read_extensions(C, t);
   read_define_opts(C, t);
   // read_margins_opts(C, t);
   // read_trace_opts(C, t);
   read_yield_opts(C, t);
   read_optimize_opts(C, t);
+  read_montecarlo_opts(C, t);
   read_xy_sweeps(C, t);
 
   toml_free(t);
@@ -789,6 +1190,100 @@ static void exclude_params_corn(Configuration *C)
 #undef include_now
 }
 
+/* Analyzes the included normal parameters that have correlations as the principal components of
+ * their correlation matrix instead, as many of the strongest as keep options.pc_variance percent of
+ * its trace. The components are added as included parameters pc1, pc2, ... of sigma 1 and nominal
+ * 0, so that the analyses run in this whitened space; the parameters are excluded, but follow the
+ * components (Param.load) into the simulations. */
+static void correlate(Configuration *C, const Builder *B)
+{
+  C->num_components = 0;
+  if (B->num_corrs == 0)
+    return;
+
+  int *group = malloc(C->num_params_all * sizeof *group);  // mem:prelocate
+  int m = 0;
+  for (int c = 0; c < B->num_corrs; ++c) {
+    for (int e = 0; 2 > e; ++e) {
+      const char *name = e ? B->corrs[c].b : B->corrs[c].a;
+      int i;
+      for (i = 0; C->num_params_all > i && strcmp(C->params[i].name, name); ++i)
+        ;
+      if (C->num_params_all == i) {
+        error("Unknown parameter '%s' in [correlations]\n", name);
+      } else if (C->num_params <= i) {
+        error("Correlated parameter '%s' must be included, and not a corner\n", name);
+      }
+      int r;
+      for (r = 0; m > r && group[r] != i; ++r)
+        ;
+      if (m == r)
+        group[m++] = i;
+    }
+  }
+
+  double *R = calloc(m * m, sizeof *R);  // mem:subnodal
+  double *val = malloc(m * sizeof *val);  // mem:anticlinal
+  double *vec = malloc(m * m * sizeof *vec);  // mem:clypeate
+  for (int r = 0; m > r; ++r)
+    R[r * m + r] = 1.0;
+  for (int c = 0; c < B->num_corrs; ++c) {
+    int ra, rb;
+    for (ra = 0; strcmp(C->params[group[ra]].name, B->corrs[c].a); ++ra)
+      ;
+    for (rb = 0; strcmp(C->params[group[rb]].name, B->corrs[c].b); ++rb)
+      ;
+    R[ra * m + rb] = R[rb * m + ra] = B->corrs[c].rho;
+  }
+  symmetric_eigen(m, R, val, vec);
+  if (val[m - 1] < -1e-9 * m) {
+    error("The correlations are inconsistent: their matrix has a negative eigenvalue (%g)\n",
+          val[m - 1]);
+  }
+  /* the strongest components; those without variance are never kept */
+  int k = 0;
+  double kept = 0.0;
+  while (m > k && val[k] > 1e-12 * m &&
+         (k == 0 || kept < C->options.pc_variance / 100.0 * m * (1.0 - 1e-12))) {
+    kept += val[k++];
+  }
+
+  C->params = params_grow(C->params, C->num_params_all + k);
+  for (int j = 0; k > j; ++j) {
+    Param *p = &C->params[C->num_params_all + j];
+    char name[16];
+    snprintf(name, sizeof name, "pc%d", j + 1);
+    *p = PARAM_DEFAULT;
+    p->name = param_name(name);
+    for (int i = 0; C->num_params_all > i; ++i) {
+      if (!strcmp(C->params[i].name, p->name)) {
+        error("Parameter '%s' has the name of a principal component\n", p->name);
+      }
+    }
+    p->nominal = 0.0;
+    p->logs = 0;
+    p->sigma = 1.0;
+    /* the component is bounded by the min and max of the parameters that follow it instead */
+    p->min = -PC_RANGE;
+    p->max = PC_RANGE;
+  }
+  for (int r = 0; m > r; ++r) {
+    Param *p = &C->params[group[r]];
+    p->include = 0;
+    p->load = malloc(k * sizeof *p->load);  // mem:upgaze
+    for (int j = 0; k > j; ++j)
+      p->load[j] = vec[r * m + j] * sqrt(val[j]);
+  }
+  C->num_params_all += k;
+  exclude_params_corn(C);
+  C->num_components = k;
+
+  free(group);  // mem:prelocate
+  free(R);      // mem:subnodal
+  free(val);    // mem:anticlinal
+  free(vec);    // mem:clypeate
+}
+
 /* Checks whether or not a file exists and is a regular file. */
 static bool file_exists(const char *path)
 {
@@ -909,6 +1404,7 @@ void build_configuration(Configuration *C, Builder *B)
   lst_drop(&B->project_tree);
   C->file_names = B->file_names;
   C->options = B->options;
+  C->accuracy = B->options.binsearch_accuracy;
   C->extensions = B->extensions;
   // drop default node & parameter data
   node_drop(&B->node_defaults);
@@ -920,6 +1416,14 @@ void build_configuration(Configuration *C, Builder *B)
   C->_2D = B->_2D;
   // remove excluded params from the running (initializing num_params_corn and num_params)
   exclude_params_corn(C);
+  // every search is taken at each of the 2^K corners, unless they are screened
+  if (C->num_params_corn > (C->options.c_screen ? 63 : CORNERS_ALL_MAX)) {
+    error("%d corner parameters are too many%s\n", C->num_params_corn,
+          C->options.c_screen ? "" : " to take at every corner (set screen = true in [corners])");
+  }
+  // and the correlated ones, in favor of their principal components
+  correlate(C, B);
+  correlations_drop(B);
 }
 
 /* Walks up the directory tree to find the directory where Malt.toml is located, and parses it.
@@ -1108,6 +1612,12 @@ Configuration *Configure(const Args *args, FILE *log)
   // 2. Parse all other .toml files between project root and target
   configure_target(&B, ptree, args->configuration);
 
+  // The simulator backend runs its own command, unless another is configured
+  if (B.options.spice_call_name == NULL) {
+    const char *command = find_backend(B.options.backend)->command;
+    B.options.spice_call_name = strdup(command);  // mem:descendentalism
+  }
+
   // 3. Redirect log output to the working directory
   // (This is the earliest point we can do this because the working directory is not known
   // before calling `configure_target`)
@@ -7,6 +7,8 @@
 #include <stdio.h>
 
 #define LINE_LENGTH 1024
+/* most corner parameters whose 2^K corners can all be taken; more need [corners] screen */
+#define CORNERS_ALL_MAX 30
 
 typedef struct node {
   const char *name;
@@ -33,6 +35,9 @@ typedef struct param {
   int include;
   int corners;
   int logs;
+  /* internal: if set, the parameter is not included but follows the principal components of its
+   * correlations, moving load[j] of its sigma per unit of the jth one */
+  double *load;
 } Param;
 
 typedef struct _2D {
@@ -50,6 +55,7 @@ struct file_names {
   char *envelope;
   char *env_call;
   char *plot;
+  char *sched;  // log of the predicted and observed times of the simulator jobs
   // TODO: delete these
   char *iter;
   char *pname;
@@ -77,12 +83,24 @@ enum filetype {
 struct options {
   int spice_verbose;
   int max_subprocesses;
+  int host_slots;         // simulator slots shared by every malt on this host, or 0 for no limit
+  const char *slot_pool;  // directory holding the lock files of the host slots
+  int max_simulations;
+  double deadline;  // seconds since the epoch, or 0.0 for none
+  int c_screen;     // corners taken: 0 all of them, 1 the worst ones the probes find per direction
+  int c_audit;      // every this many searches are taken at all corners anyway, or 0 for never
   int print_terminal;
   double binsearch_accuracy;
   int d_simulate;
   int d_envelope;
   int o_min_iter;
   int o_max_mem_k;
+  double o_binsearch_start;
+  int o_yield_dirs;   // directions of the yield of the final hull, or 0 for none
+  int o_threads;      // threads of that yield, or 0 for one per processor
+  double o_nom_step;  // sigma by which each binding nom_min/nom_max is moved, or 0 not to
+  double o_screen;    // percentage of 1-Yield that freezing non-limiting parameters may miss, or 0
+  int o_screen_dirs;  // random directions that also rank the parameters for that
   int _2D_iter;
   /* TODO: add shmoo
   float s_granularity;
@@ -93,7 +111,26 @@ struct options {
   int y_max_mem_k;
   double y_accuracy;
   int y_print_every;
+  double y_binsearch_start;
+  int y_batch;    // simplexes split per round of simulations, or 0 for one per simulator slot
+  int y_mesh;     // first simplexes: -1 auto, 0 from the corner margins, 1 from the orthants
+  int y_moments;  // simplex volumes and moments: -1 auto, 0 recomputed, 1 stored
+  int y_store;    // simplex and moment pages: 0 in memory, 1 in a mapped file of the working tree
+  int y_threads;  // threads of the passes over all the simplexes, or 0 for one per processor
+  double y_screen;    // percentage of 1-Yield that freezing non-limiting parameters may miss, or 0
+  int y_screen_dirs;  // random directions that also rank the parameters for that
+  double y_stderr;      // stop once the standard error of 1-yield is this small, or 0
+  double y_confidence;  // stop once its 95% confidence interval is within this percentage, or 0
+  int y_anneal;         // annealing schedule: 0 fixed, 1 skipped once the mesh is resolved
+  int y_surrogate;         // margins predicted from their neighbors: 0 off, 1 skip, 2 verify
+  double y_surrogate_tol;  // when the gauss integral is known to this percentage of 1-Yield
+  int mc_samples;        // Monte Carlo samples at most
+  int mc_method;         // 0 plain, 1 importance sampling about the margins, 2 directional
+  int mc_seed;           // seed of the sample streams; the same seed draws the same samples
+  double mc_confidence;  // stop once the 95% confidence interval is within this percentage, or 0
+  double pc_variance;    // percentage of the variance of the correlated parameters to keep
   const char *spice_call_name;
+  const char *backend;  // simulator backend: "wrspice", or "cli" for one-shot simulators like JoSIM
 };
 
 typedef struct config {
@@ -103,6 +140,10 @@ typedef struct config {
 
   int func_init;
 
+  /* binsearch accuracy currently in effect; coarser than options.binsearch_accuracy while an
+   * accuracy schedule is annealing */
+  double accuracy;
+
   bool keep_files;
 
   list_t working_tree;
@@ -120,6 +161,9 @@ typedef struct config {
   int num_params_corn;
   int num_params_all;
   Param *params;
+  /* the principal components of the correlated parameters, the last of the num_params included
+   * normal parameters */
+  int num_components;
 
   int num_2D;
   _2D *_2D;
@@ -7,9 +7,14 @@
 #include "marg_opt_yield.h"
 #include "space.h"
 #include "stat_math.h"
+#include <fcntl.h>
 #include <float.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #define N (C->num_params)
@@ -17,32 +22,621 @@
 #define WIDTH (C->options.y_search_width)
 #define STEPS (C->options.y_search_steps)
 #define PAGE_LINES 8192  // simplex memory page size, with 8ish bytes per line
+#define CHUNK_BYTES (2 << 20)  // arena chunk size, and alignment: that of a huge page
 
-static double big_dist(int, double **, short *, int *, int *);
+/* The pages of a simplex store, carved from big aligned chunks so that the kernel can back them
+ * with huge pages. They are only ever freed all together. What is counted as taken is what has been
+ * carved, and the ends of the chunks left behind, but not the untouched end of the last chunk.
+ *
+ * With a file (y_store), the chunks are mapped from it instead, one after another, and it is up to
+ * the page cache what stays in memory: the pages split last, as a rule, while the passes over all
+ * the simplexes read the rest in order. Their bytes are then counted in file_bytes. */
+typedef struct arena {
+  char **chunk;
+  size_t *len;  // bytes of each chunk
+  int num_chunk;
+  size_t used;  // bytes taken from the last chunk
+  long bytes;   // bytes taken, and of the table of chunks
+  int fd;       // the file of the chunks, or -1 for memory
+  long size;    // bytes of the file
+} Arena;
+
+#define ARENA_INIT                                                                               \
+  {                                                                                              \
+    NULL, NULL, 0, 0, 0, -1, 0                                                                   \
+  }
+
+/* bytes held by the stores of cropc: vectors, simplexes, moments, FOM heap and incidence lists */
+static long mem_bytes = 0;
+/* and bytes of the stores mapped from files instead */
+static long file_bytes = 0;
+
+static double big_dist(int, double **, vertex_t *, int *, int *);
 static void bord(int, int, int *);
 static void norm_v(int, double *);
-static double svol(int, double **, short *, double **, double **, double *);
-static void sval(int, double, short *, double *, double *, double *, double *, double);
+static double svol(int, double **, vertex_t *, double **, double **, double *);
+static void sval(int, double, vertex_t *, double *, double *, double *, double *, double);
+static void smom(int, vertex_t *, double *, double *, double *);
 static void ludcmp(double **, int, double *, double *);
-static void vect_realloc(int *, int, int, double **, double **, double ***);
-static void simp_realloc(int *, int, double ***, short ***, int);
-static void vect_free(int, double *, double *, double **);
-static void simp_free(int, double **, short **);
+static void vect_grow(int *, int, int, double **, double **, double **, double ***);
+static void simp_grow(Arena *, int *, int, double ***, vertex_t ***, int);
+static void vect_free(int, double *, double *, double *, double **);
+static void simp_free(Arena *, int, double **, vertex_t **);
+
+/* An indexed max-heap of the simplexes by powm, so that the one to split next is found in O(1) and
+ * kept up in O(log num_simp) as simplexes are split. Ties go to the lower simplex index, which is
+ * the one a scan of powm would pick. */
+typedef struct fom_heap {
+  int *heap;  // simplex indexes, the greatest powm first
+  int *pos;   // position of each simplex in heap[]
+  int num, mem;
+} FomHeap;
+
+/* The simplexes that have a given point (vector) among theirs, in no particular order, so that
+ * the simplexes to split are found without a scan of t. */
+typedef struct incidence {
+  int *simp;
+  int num, mem;
+} Incidence;
+
+static void inc_add(Incidence *I, int s)
+{
+  if (I->num == I->mem) {
+    mem_bytes += (I->mem ? I->mem : 8) * (long)sizeof *I->simp;
+    I->mem = I->mem ? 2 * I->mem : 8;
+    I->simp = realloc(I->simp, I->mem * sizeof *I->simp);  // mem:yokefellow
+  }
+  I->simp[I->num++] = s;
+}
 
-static int corn(Configuration *C, const Space *S, int num_marg, int *bin, double *cmarg)
+/* Brings the incidences up to `mem` points, the new ones with no simplexes yet. */
+static void inc_grow(Incidence **inc, int *num, int mem)
 {
-  int i, j, k;
+  *inc = realloc(*inc, mem * sizeof **inc);  // mem:gravimeter
+  memset(&(*inc)[*num], 0, (mem - *num) * sizeof **inc);
+  mem_bytes += (mem - *num) * (long)sizeof **inc;
+  *num = mem;
+}
+
+static void inc_remove(Incidence *I, int s)
+{
+  for (int m = 0; I->num > m; ++m) {
+    if (I->simp[m] == s) {
+      I->simp[m] = I->simp[--I->num];
+      return;
+    }
+  }
+}
+
+/* Returns `size` bytes from the arena, aligned to a cache line. */
+static void *arena_alloc(Arena *A, size_t size)
+{
+  long taken, *count = (A->fd >= 0) ? &file_bytes : &mem_bytes;
+
+  size = (size + 63) & ~(size_t)63;
+  if (A->num_chunk == 0 || A->used + size > A->len[A->num_chunk - 1]) {
+    /* whole chunks, so that the next one is mapped from a page boundary of the file */
+    size_t bytes = (size + CHUNK_BYTES - 1) & ~(size_t)(CHUNK_BYTES - 1);
+    /* the end of the last chunk is left behind */
+    taken = A->num_chunk ? A->len[A->num_chunk - 1] - A->used : 0;
+    taken += sizeof *A->chunk + sizeof *A->len;
+    A->bytes += taken;
+    *count += taken;
+    void *chunk;
+    if (A->fd >= 0) {
+      /* the blocks are taken now, lest a full disk show up as SIGBUS later on */
+      chunk = posix_fallocate(A->fd, A->size, bytes) ? MAP_FAILED
+                                                      : mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                                                             MAP_SHARED, A->fd, A->size);
+      if (chunk == MAP_FAILED) {  // mem:ungreened
+        fprintf(stderr, "malt: Out of disk for %zu more bytes of simplexes\n", bytes);
+        exit(EXIT_FAILURE);
+      }
+      A->size += bytes;
+    } else {
+      if (posix_memalign(&chunk, CHUNK_BYTES, bytes) != 0) {  // mem:ungreened
+        fprintf(stderr, "malt: Out of memory for %zu more bytes of simplexes\n", bytes);
+        exit(EXIT_FAILURE);
+      }
+#ifdef MADV_HUGEPAGE
+      madvise(chunk, bytes, MADV_HUGEPAGE);
+#endif
+    }
+    A->chunk = realloc(A->chunk, (A->num_chunk + 1) * sizeof *A->chunk);  // mem:seedlip
+    A->len = realloc(A->len, (A->num_chunk + 1) * sizeof *A->len);        // mem:hodmandod
+    A->len[A->num_chunk] = bytes;
+    A->chunk[A->num_chunk++] = chunk;
+    A->used = 0;
+  }
+  void *at = A->chunk[A->num_chunk - 1] + A->used;
+  A->used += size;
+  A->bytes += size;
+  *count += size;
+  return at;
+}
+
+/* Maps the chunks of arena `A` from a new file `name` from now on. The file is unlinked at once, so
+ * that it is gone with malt however malt ends. Returns 0 if it cannot be made. */
+static int arena_file(Arena *A, const char *name)
+{
+  if ((A->fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0) {
+    fprintf(stderr, "malt: Cannot create %s for the simplexes\n", name);
+    return 0;
+  }
+  unlink(name);
+  return 1;
+}
+
+static void arena_free(Arena *A)
+{
+  for (int i = 0; A->num_chunk > i; ++i)
+    if (A->fd >= 0)
+      munmap(A->chunk[i], A->len[i]);  // mem:ungreened
+    else
+      free(A->chunk[i]);  // mem:ungreened
+  free(A->chunk);         // mem:seedlip
+  free(A->len);           // mem:hodmandod
+  if (A->fd >= 0)
+    close(A->fd);
+  A->chunk = NULL;
+  A->len = NULL;
+  A->num_chunk = 0;
+  A->used = 0;
+  A->bytes = 0;
+  A->fd = -1;
+  A->size = 0;
+}
+
+/* Asks for the `bytes` at `at` of a store mapped from a file to be read ahead. */
+static void read_ahead(const void *at, size_t bytes)
+{
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE), from = (uintptr_t)at & ~(page - 1);
+
+  posix_madvise((void *)from, bytes + ((uintptr_t)at - from), POSIX_MADV_WILLNEED);
+}
+
+static int by_index(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/* How a simplex is evaluated by seval, when there is a moment store. */
+enum { STORED, NEW_MARGINS, NEW_SHAPE };
+
+/* Returns the volume of a simplex, from the moment store `m` if there is one. */
+static double svolume(int dim, double **p, vertex_t *tt, double **a, double **w, double *vv,
+                      const double *m)
+{
+  return m ? m[0] : svol(dim, p, tt, a, w, vv);
+}
+
+/* Evaluates a simplex like svol and sval, and returns its volume.
+ *
+ * `m` is the simplex's entry in the moment store: its volume and [unweighted] mean and variance. If
+ * it is NULL, everything is recomputed. Otherwise `how` says what has to be: nothing (STORED), the
+ * moments after a change of gmarg (NEW_MARGINS), or the volume too (NEW_SHAPE). Either way, the
+ * results are the same to the bit.
+ */
+static double seval(int dim, double s_gain, double **p, vertex_t *tt, double *gmarg, double **a,
+                    double **w, double *vv, double *m, int how, double *mean, double *powm,
+                    double *vari)
+{
+  if (!m) {
+    double volu = svol(dim, p, tt, a, w, vv);
+    sval(dim, s_gain, tt, gmarg, mean, powm, vari, volu);
+    return volu;
+  }
+  if (how == NEW_SHAPE)
+    m[0] = svol(dim, p, tt, a, w, vv);
+  if (how != STORED)
+    smom(dim, tt, gmarg, &m[1], &m[2]);
+  /* as sval does it */
+  *mean = m[1] * m[0];
+  *vari = m[2] * (m[0] * m[0]);
+  *powm = pow(m[1], s_gain) * m[0];
+  return m[0];
+}
+
+/* Brings the moment store up to `pages` pages. */
+static void mom_grow(Arena *A, int *numrow, int pages, double ***mom)
+{
+  *mom = realloc(*mom, pages * sizeof **mom);  // mem:vicarages
+  mem_bytes += (pages - *numrow) * (long)sizeof **mom;
+  for (; pages > *numrow; ++*numrow)
+    (*mom)[*numrow] = arena_alloc(A, 3 * PAGE_LINES * sizeof ***mom);
+}
+
+/* A pass of seval over all the simplexes, or of sval at the seven scaled sigmas (when `gmarg7` is
+ * not NULL), split by page over the threads. */
+typedef struct simp_pass {
+  int dim, num_simp, how;
+  double s_gain;
+  double **p, *gmarg, **gmarg7;
+  vertex_t **t;
+  double **powm, **mom;
+  double *sums;  // per page: see PASS_SUMS
+  int num_threads;
+  int stream;  // the pages are mapped from a file, to be read ahead
+} SimpPass;
+
+/* totals per page: mean, variance and volume, then the means and variances at the seven scales */
+#define PASS_SUMS (3 + 2 * 7)
+
+/* One thread of a pass, with the svol workspace it has to itself. */
+typedef struct simp_work {
+  SimpPass *P;
+  int id;
+  double **a, **w, *vv;
+} SimpWork;
+
+/* a pass over the simplexes of cropc as they are now */
+#define SIMP_PASS(how_, gmarg7_)                                                                 \
+  (SimpPass)                                                                                     \
+  {                                                                                              \
+    .dim = N, .num_simp = num_simp, .how = (how_), .s_gain = s_gain, .p = p, .gmarg = gmarg,    \
+    .gmarg7 = (gmarg7_), .t = t, .powm = powm, .mom = mom, .sums = NULL, .num_threads = 0,       \
+    .stream = simp_arena.fd >= 0                                                                 \
+  }
+
+static void *simp_pass_pages(void *arg)
+{
+  SimpWork *W = arg;
+  SimpPass *P = W->P;
+  int dim = P->dim, pages = (P->num_simp + PAGE_LINES - 1) / PAGE_LINES;
+  double mean, powm, vari;
+
+  for (int pg = W->id; pages > pg; pg += P->num_threads) {
+    double *sum = &P->sums[pg * PASS_SUMS];
+    int end = (pg + 1) * PAGE_LINES < P->num_simp ? (pg + 1) * PAGE_LINES : P->num_simp;
+    /* this thread's next page comes in while this one is worked on */
+    if (P->stream && pages > pg + P->num_threads) {
+      int next = pg + P->num_threads;
+      read_ahead(P->t[next], PAGE_LINES * dim * sizeof **P->t);
+      read_ahead(P->powm[next], PAGE_LINES * sizeof **P->powm);
+      if (P->mom)
+        read_ahead(P->mom[next], 3 * PAGE_LINES * sizeof **P->mom);
+    }
+    for (int k = 0; PASS_SUMS > k; ++k)
+      sum[k] = 0.0;
+    for (int s = pg * PAGE_LINES; end > s; ++s) {
+      vertex_t *tt = &P->t[pg][(s % PAGE_LINES) * dim];
+      double *m = P->mom ? &P->mom[pg][(s % PAGE_LINES) * 3] : NULL;
+      if (!P->gmarg7) {
+        sum[2] += seval(dim, P->s_gain, P->p, tt, P->gmarg, W->a, W->w, W->vv, m, P->how, &mean,
+                        &P->powm[pg][s % PAGE_LINES], &vari);
+        sum[0] += mean;
+        sum[1] += vari;
+        continue;
+      }
+      double volu = svolume(dim, P->p, tt, W->a, W->w, W->vv, m);
+      sum[2] += volu;
+      for (int j = 0; 7 > j; ++j) {
+        sval(dim, P->s_gain, tt, P->gmarg7[j], &mean, &powm, &vari, volu);
+        sum[3 + j] += mean;
+        sum[10 + j] += vari;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Runs a pass on up to `num_work` threads, one per workspace `W[..]`, and adds up its totals into
+ * `total[0..PASS_SUMS]`. The totals are kept per page and added up in page order, so they are the
+ * same to the bit for any number of threads. */
+static void simp_pass(SimpPass *P, SimpWork *W, int num_work, double *total)
+{
+  int pages = (P->num_simp + PAGE_LINES - 1) / PAGE_LINES;
+  pthread_t *thread = malloc(num_work * sizeof *thread);  // mem:spoonwood
+
+  P->sums = malloc(pages * PASS_SUMS * sizeof *P->sums);  // mem:fishwives
+  P->num_threads = num_work < pages ? num_work : pages;
+  for (int i = 0; P->num_threads > i; ++i) {
+    W[i].P = P;
+    W[i].id = i;
+  }
+  /* this thread takes the first share, and any that a thread could not be started for */
+  int started = 1;
+  while (P->num_threads > started &&
+         pthread_create(&thread[started], NULL, simp_pass_pages, &W[started]) == 0)
+    ++started;
+  simp_pass_pages(&W[0]);
+  for (int i = started; P->num_threads > i; ++i)
+    simp_pass_pages(&W[i]);
+  for (int i = 1; started > i; ++i)
+    pthread_join(thread[i], NULL);
+
+  for (int k = 0; PASS_SUMS > k; ++k)
+    total[k] = 0.0;
+  for (int pg = 0; pages > pg; ++pg)
+    for (int k = 0; PASS_SUMS > k; ++k)
+      total[k] += P->sums[pg * PASS_SUMS + k];
+  free(P->sums);  // mem:fishwives
+  P->sums = NULL;
+  free(thread);  // mem:spoonwood
+}
+
+/* Up to SVOL_FIT dimensions, svol is fitted to add up to the volume of the hypersphere av. Past
+ * that, its volumes are only good relative to one another, so the totals are normalized by their
+ * sum instead. */
+#define SVOL_FIT 10
+#define VNORM (N > SVOL_FIT ? tvol : av)
+
+#define MOM(s) (mom ? &mom[(s) / PAGE_LINES][((s) % PAGE_LINES) * 3] : NULL)
+
+#define POWM(s) (powm[(s) / PAGE_LINES][(s) % PAGE_LINES])
+
+/* Returns nonzero if simplex a should come before simplex b. */
+static int fom_before(double **powm, int a, int b)
+{
+  return POWM(a) > POWM(b) || (POWM(a) == POWM(b) && a < b);
+}
+
+static void fom_place(FomHeap *H, int at, int s)
+{
+  H->heap[at] = s;
+  H->pos[s] = at;
+}
+
+static void fom_sift_up(FomHeap *H, double **powm, int at)
+{
+  int s = H->heap[at];
+  while (at > 0 && fom_before(powm, s, H->heap[(at - 1) / 2])) {
+    fom_place(H, at, H->heap[(at - 1) / 2]);
+    at = (at - 1) / 2;
+  }
+  fom_place(H, at, s);
+}
+
+static void fom_sift_down(FomHeap *H, double **powm, int at)
+{
+  int s = H->heap[at];
+  for (int child; (child = 2 * at + 1) < H->num; at = child) {
+    if (child + 1 < H->num && fom_before(powm, H->heap[child + 1], H->heap[child]))
+      ++child;
+    if (!fom_before(powm, H->heap[child], s))
+      break;
+    fom_place(H, at, H->heap[child]);
+  }
+  fom_place(H, at, s);
+}
+
+/* Makes room for `mem` simplexes. */
+static void fom_grow(FomHeap *H, int mem)
+{
+  H->heap = realloc(H->heap, mem * sizeof *H->heap);  // mem:scrobicule
+  H->pos = realloc(H->pos, mem * sizeof *H->pos);     // mem:bathybius
+  mem_bytes += (mem - H->mem) * (long)(sizeof *H->heap + sizeof *H->pos);
+  H->mem = mem;
+}
+
+/* Rebuilds the heap over simplexes 0..num_simp-1 in bulk, e.g. after s_gain changes every powm. */
+static void fom_build(FomHeap *H, double **powm, int num_simp)
+{
+  H->num = num_simp;
+  for (int s = 0; num_simp > s; ++s)
+    fom_place(H, s, s);
+  for (int at = num_simp / 2 - 1; at >= 0; --at)
+    fom_sift_down(H, powm, at);
+}
+
+/* Puts the new simplex `s` in its place, after its powm is set. */
+static void fom_push(FomHeap *H, double **powm, int s)
+{
+  fom_place(H, H->num++, s);
+  fom_sift_up(H, powm, H->num - 1);
+}
+
+/* Puts simplex `s` back in its place after its powm has changed. */
+static void fom_update(FomHeap *H, double **powm, int s)
+{
+  fom_sift_up(H, powm, H->pos[s]);
+  fom_sift_down(H, powm, H->pos[s]);
+}
+
+/* Takes the simplex with the greatest FOM off the heap and returns it. */
+static int fom_pop(FomHeap *H, double **powm)
+{
+  int s = H->heap[0];
+  if (--H->num > 0) {
+    fom_place(H, 0, H->heap[H->num]);
+    fom_sift_down(H, powm, 0);
+  }
+  return s;
+}
+
+static int has_point(int dim, const vertex_t *tt, int v)
+{
+  for (int j = 0; dim > j; ++j)
+    if (tt[j] == v)
+      return 1;
+  return 0;
+}
+
+/* Returns nonzero if simplex `r` would be touched by one of the `num_edge` splits already chosen.
+ * An edge a-b is chosen as edge[] = {a, b}, and a quadrant simplex s as edge[] = {s, -1}. */
+static int simp_conflicts(int dim, const vertex_t *tt, int r, const int *edge, int num_edge)
+{
+  for (int e = 0; num_edge > e; ++e) {
+    int touched = (edge[2 * e + 1] < 0)
+                      ? r == edge[2 * e]
+                      : has_point(dim, tt, edge[2 * e]) && has_point(dim, tt, edge[2 * e + 1]);
+    if (touched)
+      return 1;
+  }
+  return 0;
+}
+
+/* Returns nonzero if bisecting the edge a-b would touch a simplex that one of the `num_edge` splits
+ * already chosen also touches, i.e. if the splits would not be independent. */
+static int edge_conflicts(int dim, vertex_t **t, const Incidence *inc, int a, int b,
+                          const int *edge, int num_edge)
+{
+  for (int m = 0; inc[a].num > m; ++m) {
+    int r = inc[a].simp[m];
+    vertex_t *tt = &t[r / PAGE_LINES][(r % PAGE_LINES) * dim];
+    if (has_point(dim, tt, b) && simp_conflicts(dim, tt, r, edge, num_edge))
+      return 1;
+  }
+  return 0;
+}
+
+/* Returns nonzero if the simplex is a whole quadrant, with none but on-axis points. */
+static int is_quadrant(int dim, const vertex_t *tt)
+{
+  for (int j = 0; dim > j; ++j)
+    if (tt[j] >= 2 * dim)
+      return 0;
+  return 1;
+}
+
+/* how a new vector of cropc gets its margin: by a search, or predicted by the surrogate (and then
+ * not simulated at all, or only point-checked at its lower bound), as options.y_surrogate */
+enum { SUR_SEARCH, SUR_SKIP, SUR_VERIFY };
+
+static double dot(int dim, const double *a, const double *b)
+{
+  double sum = 0.0;
+
+  for (int i = 0; dim > i; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+/* The surrogate: a Gaussian process over the searched vertices of the simplex `tt` that the new
+ * vector splits, which are its neighbors (no other margins are searched for nearer ones), with a
+ * kernel of the angle between unit vectors. It models the reciprocal of the margin, which is smooth
+ * on the sphere where the margin is not (for an ellipsoid its square is a quadratic form), and
+ * takes the spread of all `num` margins so far for its variance, lest a few alike neighbors make
+ * it sure of itself. Stores the predicted margin along the unit vector `x` in *mean, and its
+ * standard deviation in *sd (no less than half the binsearch accuracy `acc`, which is as good as a
+ * search would do). Returns 0 if it cannot predict: with fewer than three searched points, points
+ * all alike, or a margin that may be unbounded. */
+static int surrogate(int dim, int num, double **p, const vertex_t *tt, const double *marg,
+                     const double *vacc, const double *gband, const double *x, double acc,
+                     double *mean, double *sd)
+{
+  int n = 0, m = 0, ok = 0;
+  int *v = malloc(dim * sizeof *v);           // mem:splenius
+  double *L = malloc(dim * dim * sizeof *L);  // mem:stoccado
+  double *y = malloc(dim * sizeof *y);        // mem:hamesucken
+  double *k = malloc(dim * sizeof *k);        // mem:grithbreach
+  double ybar = 0.0, s2 = 0.0, ell2 = 0.0, sum = 0.0, sum2 = 0.0;
+
+  /* the searched points only: predictions do not feed predictions */
+  for (int j = 0; dim > j; ++j)
+    if (gband[tt[j]] == 0.0)
+      v[n++] = tt[j];
+  if (n < 3)
+    goto done;
+  for (int i = 0; n > i; ++i)
+    ybar += 1.0 / marg[v[i]] / n;
+  for (int i = 0; num > i; ++i)
+    if (gband[i] == 0.0) {
+      sum += 1.0 / marg[i];
+      sum2 += 1.0 / (marg[i] * marg[i]);
+      ++m;
+    }
+  if (m > 1)
+    s2 = (sum2 - sum * sum / m) / (m - 1);
+  /* the length scale is the spread of the points, in 1 - cos(angle) */
+  for (int i = 0; n > i; ++i)
+    for (int j = 0; i > j; ++j)
+      ell2 += (1.0 - dot(dim, p[v[i]], p[v[j]])) / (n * (n - 1) / 2);
+  if (s2 <= 0.0 || ell2 <= 0.0)
+    goto done;
+  /* Cholesky factor of the covariance, K = L L', with the noise of each search on the diagonal */
+  for (int i = 0; n > i; ++i) {
+    for (int j = 0; i >= j; ++j) {
+      double a = s2 * exp(-(1.0 - dot(dim, p[v[i]], p[v[j]])) / ell2);
+      if (i == j)
+        a += vacc[v[i]] * vacc[v[i]] / 4.0 / pow(marg[v[i]], 4.0);
+      for (int l = 0; j > l; ++l)
+        a -= L[i * n + l] * L[j * n + l];
+      if (i == j) {
+        if (a <= 0.0)
+          goto done;
+        L[i * n + i] = sqrt(a);
+      } else {
+        L[i * n + j] = a / L[j * n + j];
+      }
+    }
+  }
+  /* mean = ybar + k' K^-1 (y - ybar), var = s2 - |L^-1 k|^2 */
+  for (int i = 0; n > i; ++i) {
+    y[i] = 1.0 / marg[v[i]] - ybar;
+    k[i] = s2 * exp(-(1.0 - dot(dim, x, p[v[i]])) / ell2);
+    for (int l = 0; i > l; ++l) {
+      y[i] -= L[i * n + l] * y[l];
+      k[i] -= L[i * n + l] * k[l];
+    }
+    y[i] /= L[i * n + i];
+    k[i] /= L[i * n + i];
+  }
+  double mu = ybar, var = s2;
+  for (int i = 0; n > i; ++i) {
+    mu += k[i] * y[i];  // (L^-1 k)' (L^-1 (y - ybar))
+    var -= k[i] * k[i];
+  }
+  if (var < 0.0)
+    var = 0.0;
+  if (mu <= 2.0 * sqrt(var))
+    goto done;
+  /* and back to the margin */
+  *mean = 1.0 / mu;
+  *sd = sqrt(var) / (mu * mu);
+  if (*sd < acc / 2.0)
+    *sd = acc / 2.0;
+  ok = 1;
+done:
+  free(k);  // mem:grithbreach
+  free(y);  // mem:hamesucken
+  free(L);  // mem:stoccado
+  free(v);  // mem:splenius
+  return ok;
+}
+
+/* Returns the binsearch accuracy for annealing step `step`, tightening geometrically from
+ * y_binsearch_start at the first step to binsearch_accuracy at the last. */
+static double anneal_accuracy(const Configuration *C, int step)
+{
+  double fine = C->options.binsearch_accuracy, coarse = C->options.y_binsearch_start;
+
+  if (coarse <= fine || STEPS < 2 || step >= STEPS - 1)
+    return fine;
+  if (step < 0)
+    step = 0;
+  return fine * pow(coarse / fine, (STEPS - 1 - step) / (double)(STEPS - 1));
+}
+
+/* Sets up the search of corner margin `k`, along the vector `bin` of k, in `dirs[k*dim..]`. */
+static Search corn_search(int dim, int k, int *bin, const double *pc, double *dirs, double *prs)
+{
+  double *direction = &dirs[k * dim];
+
+  bord(dim, k, bin);
+  for (int i = 0; dim > i; i++) {
+    direction[i] = (bin[i]) ? -0.5 : 0.5;  // direction is negative-wise!!
+  }
+  Search search = SEARCH_INIT(pc, direction, &prs[k * dim]);
+  /* the margins check the center first, so it need not be simulated again */
+  search.skip_center = 1;
+  return search;
+}
+
+/* Prints the corner margins found by the `searches[..]` of corn_search, in order, and stores them
+ * in `cmarg[..]`. */
+static int corn(Configuration *C, const Space *S, int num_marg, int *bin, double *cmarg,
+                const Search *searches)
+{
+  int j, k;
   int ret = 0;
   int small_print = 1, small_print_old;
   double smaller = 1e300;  // none larger
   double yield, yield_c;
-  double *pc = malloc((N + C->num_params_corn) * sizeof *pc);  // mem:syntagma
-  double *direction = malloc(N * sizeof *direction);           // mem:rebuffing
-  double *pr = malloc(N * sizeof *pr);
 
   /* print header */
   /* how many iterations it will be really */
-  lprintf(C, "\nCorners: %d margins x %d corners\n", 1 << N, 1 << C->num_params_corn);
+  lprintf(C, "\nCorners: %d margins x %d corners\n", 1 << N, corners_per_search(C));
   lprintf(C, "Iteration           Vector/Corner M(sigma)   Parameter_values\n");
   /* 1) calculate all corner margins in N-dimensional space */
   /* k indexes all 2^(N-1) margins. i indexes the params */
@@ -50,13 +644,10 @@ static int corn(Configuration *C, const Space *S, int num_marg, int *bin, double
     /* convert the iteration numbers to the binary bin vector */
     bord(N, k, bin);
 
-    /* take the margin */
-    for (i = 0; N > i; i++) {
-      pc[i] = S[i].centerpnt;                // initialize
-      direction[i] = (bin[i]) ? -0.5 : 0.5;  // direction is negative-wise!!
-    }
-    corner_t cornmin;
-    if ((cmarg[k] = addpoint_corners(C, S, &cornmin, pr, pc, direction)) == 0.0) {
+    /* the margin, taken along with the 1-D margins */
+    corner_t cornmin = searches[k].cornmin;
+    const double *pr = searches[k].pr;
+    if ((cmarg[k] = searches[k].margin) == 0.0) {
       fprintf(stderr, "Circuit failed for nominal parameter values\n");
       goto fail;
     }
@@ -87,7 +678,7 @@ static int corn(Configuration *C, const Space *S, int num_marg, int *bin, double
       /* the corner */
       lprintf(C, "/");
       for (j = N; C->num_params_corn + N > j; j++) {
-        lprintf(C, "%s", cornmin & (1 << j) ? "H" : "L");
+        lprintf(C, "%s", (cornmin >> (j - N)) & 1 ? "H" : "L");
       }
       /* pad it out with whitespace */
       for (; 7 + N > j; j++) {
@@ -124,9 +715,6 @@ static int corn(Configuration *C, const Space *S, int num_marg, int *bin, double
   }
   ret = 1;
 fail:
-  free(pc);         // mem:syntagma
-  free(direction);  // mem:rebuffing
-  free(pr);
   return ret;
 }
 
@@ -138,73 +726,151 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
   int num_simp, news, max_num_simp, simp_bytes, mysimp;
   int mem_vect = 0, inc_vect;
   int mem_simp, inc_simp, mem_simp_pages = 0, inc_simp_pages;
-  int mypage, mod_mypage, mylines;
-  int stepping = 1, stop = 0;
-  int big1, big2, tbig1, tbig2, ibig, jbig, j1, j2, r, rxn, nm1 = N - 1;
+  int stepping = 1, stop = 0, over_budget = 0;
+  int big1, big2, tbig1, tbig2, j1 = 0, j2 = 0, r, rxn;
   double f, g, itmax, itmin;
-  double ave, sigma, biggest, temp;
+  double ave, sigma, temp;
   double mean_old, mean_new, vari_old, vari_new;
   double s_gain;
   int ret = 1, num_marg;
   int small_print = 1, small_print_old;
   double smaller = 1e300;  // none larger
   /* simplexes */
-  short **t = NULL, *t_i, *t_ijxn, *t_ijxn2;  // simplex point indexes
-  double mean, vari, volu;                    // simplex measures
-  double **powm = NULL, *powm_i, *powm_ij, *powm_ij2;
+  vertex_t **t = NULL, *t_ijxn, *t_ijxn2;  // simplex point indexes
+  double mean, vari;                    // simplex measures
+  double **powm = NULL, *powm_ij, *powm_ij2;
   double tm, tv, ts, av;  // simplex totals
+  double tvol, vol_old, vol_new;  // and their volume, which is what av is past the fitted svol
   /* vectors */
   double **p = NULL;                   // unit vectors for the binary search
   double *marg = NULL, *gmarg = NULL;  // vector values
-  double tm7[7], tv7[7], scale7[7], mean7, powm7, ave7[7], sigma7[7];  // endgame stuff
-
-  // x =        0  1  2  3   4    5    6     7      8       9       10
-  int fact[] = {1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880, 3628800};  // factorial!
+  double *vacc = NULL;                 // binsearch accuracy each vector was found with
+  double tm7[7], tv7[7], scale7[7], ave7[7], sigma7[7];  // endgame stuff
+  double total[PASS_SUMS];                               // simplex totals of a pass
+  SimpPass pass;
+  FomHeap fom = {NULL, NULL, 0, 0};  // simplexes by powm
+  double **mom = NULL;               // moment store: volu, [unweighted] mean & vari per simplex
+  int mem_mom_pages = 0;
+  Arena simp_arena = ARENA_INIT, mom_arena = ARENA_INIT;  // their pages
+  long max_mem = (long)C->options.y_max_mem_k * 1024, page_bytes;
+  double svol_seconds;
+  Incidence *inc = NULL;          // simplexes by point
+  int mem_inc = 0, num_pair = 0, *pair = NULL;
+  int batch, num_batch, num_popped, b;  // simplexes split per round of simulations
+  int num_copy, c;                      // new simplexes per simplex split
+  double *gband = NULL;  // half the 95% band of the gauss integral of a predicted vector, else 0
+  int mem_band = 0, num_run, num_again;
+  long sur_refuted = 0, verify_sims = 0, search_sims = 0, num_searched = 0, sims0;
+  double mu, sd;
 
   /* Number of corners & vectors */
-  num_marg = (1 << N);          // =2**N
-  num_vect = 2 * N + num_marg;  // initial number of vectors
+  num_marg = C->options.y_mesh ? 0 : 1 << N;  // =2**N corner vectors, or none for the orthants
+  num_vect = 2 * N + num_marg;                // initial number of vectors
 
   /* Exit criteria things */
   /* limit memory to a 32GiByte */
   if (C->options.y_max_mem_k > 33554432)
     C->options.y_max_mem_k = 33554432;
   /* translate max_mem to max_ns */
-  /* bytes per simplex: (double)powm=8, (short)t=N*2 */
-  simp_bytes = 8 + N * 2;
+  /* bytes per simplex: (double)powm=8, (vertex_t)t=N*4, (int)fom.heap & fom.pos=8, (int)inc=N*4 */
+  /* (of which powm and t are in the file, if they are stored in one) */
+  simp_bytes = (C->options.y_store ? 0 : 8 + N * 4) + 8 + N * 4;
   max_num_simp = (int)(((long)C->options.y_max_mem_k * 1024) /
                        (long)simp_bytes);  // fits within a [signed] int, which is plenty
-  max_num_vect = 32767;                    // because t is of type [signed] short, which is plenty
+  max_num_vect = 1 << 28;                  // far more than the simplexes could take
+  /* initial number of simplexes: N for each of the 2**N quadrants, or the quadrant itself */
+  if (ldexp(num_marg ? N : 1, N) > max_num_simp) {
+    fprintf(stderr, "The first %.0f simplexes need more than y_max_mem_k = %d [KiB]\n",
+            ldexp(num_marg ? N : 1, N), C->options.y_max_mem_k);
+    return 0;
+  }
+  num_simp = num_marg ? N * num_marg : 1 << N;
+  mem_bytes = 0;
+  file_bytes = 0;
+  /* the simplex and moment pages out of memory, in the working tree */
+  if (C->options.y_store) {
+    Arena *arena[2] = {&simp_arena, &mom_arena};
+    const char *what[2] = {"simplexes", "moments"};
+    char *name = NULL;
+    int ok = 1;
+    for (i = 0; 2 > i && ok; ++i) {
+      resprintf(&name, "%s/%s.%c", lst_last(&C->working_tree), what[i], C->function);  // mem:gobony
+      ok = arena_file(arena[i], name);
+    }
+    free(name);  // mem:gobony
+    if (!ok) {
+      arena_free(&simp_arena);
+      return 0;
+    }
+  }
 
   /* Annealing schedule things */
-  num_vect_stride = pow(2 + DEPTH / 10.0, N) / STEPS + 1;
+  /* (past about 10 parameters, this is the simulation budget that stops it) */
+  num_vect_stride = fmin(pow(2 + DEPTH / 10.0, N) / STEPS + 1, max_num_vect / STEPS);
   anneal_iter = num_vect_stride * STEPS;
   finish_iter = anneal_iter / 2 + 1;           // this is the amount after the initial anneal_iter
   num_vect_step = num_vect / num_vect_stride;  // offset caused by the initial num_vect iterations
   s_gain = pow((10 - WIDTH) / 10.0, STEPS - 1 - num_vect_step);  // initial s_gain
 
-  double *improve = malloc((finish_iter) * sizeof *improve);  // mem:knackwursts
-  double *pr = malloc(N * sizeof *pr);
+  /* one split per free simulator slot, so that no slot sits idle while the next is chosen */
+  batch = C->options.y_batch;
+  if (batch <= 0) {
+    batch = C->options.max_subprocesses > 0 ? C->options.max_subprocesses
+                                            : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    batch /= corners_per_search(C);  // every search takes a slot per corner
+  }
+  if (batch < 1)
+    batch = 1;
+
+  double *improve = malloc((finish_iter) * sizeof *improve);  // mem:flitch
+  double *pr = malloc(batch * N * sizeof *pr);                 // mem:tamarau
   double *pc = malloc((N + C->num_params_corn) * sizeof *pc);  // mem:personifications
-  double *direction = malloc(N * sizeof *direction);           // mem:russe
+  double *direction = malloc(batch * N * sizeof *direction);   // mem:russe
+  Search *searches = malloc(batch * sizeof *searches);         // mem:unbuttered
+  int *edge = malloc(2 * batch * sizeof *edge);                // mem:quaich
+  int *popped = malloc(4 * batch * sizeof *popped);            // mem:bodach
+  /* the surrogate's say on each split of a round, and the searches and point-checks run */
+  int *use = malloc(batch * sizeof *use);                                // mem:corbie
+  double *pred = malloc(3 * batch * sizeof *pred);                       // mem:sgian
+  double *vpc = malloc(batch * (N + C->num_params_corn) * sizeof *vpc);  // mem:tappit
+  Search *run = malloc(batch * sizeof *run);                             // mem:clachan
+  int *run_b = malloc(2 * batch * sizeof *run_b);                        // mem:kailyard
 
   inc_vect = 1.3 * (anneal_iter + finish_iter);  // at least enough memory for a normal exit
-  vect_realloc(&mem_vect, inc_vect, N, &marg, &gmarg, &p);  // mem:dissinew
+  vect_grow(&mem_vect, inc_vect, N, &marg, &gmarg, &vacc, &p);
 
   /* make inc_simp more simplex arrays */
-  inc_simp = 2 * N * num_marg + fact[N] +
-             1000;  // at least enough memory for the initial simplexes across quads
+  inc_simp = 2 * num_simp + 1000;  // at least enough memory for the initial simplexes across quads
   inc_simp_pages = inc_simp / PAGE_LINES + 1;
-  simp_realloc(&mem_simp_pages, inc_simp_pages, &powm, &t, N);  // mem:enjoined
+  simp_grow(&simp_arena, &mem_simp_pages, inc_simp_pages, &powm, &t, N);
   mem_simp = mem_simp_pages * PAGE_LINES;
+  fom_grow(&fom, mem_simp);
   /* some temp storage for some math */
   double **mya = malloc(N * sizeof *mya);  // mem:outguessing
-  double **myw = malloc(N * sizeof *myw);  // mem:outguessing
+  double **myw = malloc(N * sizeof *myw);  // mem:pigsney
   for (i = 0; N > i; ++i) {
     mya[i] = malloc(N * sizeof *mya[i]);  // mem:renderer
-    myw[i] = malloc(N * sizeof *myw[i]);  // mem:renderer
+    myw[i] = malloc(N * sizeof *myw[i]);  // mem:rumbelow
   }
   double *vv = malloc(N * sizeof *vv);  // mem:crumpling
+  /* and as much again for each more thread of the passes over all the simplexes */
+  int num_work = C->options.y_threads > 0 ? C->options.y_threads
+                                          : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_work < 1)
+    num_work = 1;
+  SimpWork *work = malloc(num_work * sizeof *work);  // mem:overhale
+  work[0] = (SimpWork){NULL, 0, mya, myw, vv};
+  for (k = 1; num_work > k; ++k) {
+    work[k].a = malloc(N * sizeof *work[k].a);  // mem:wergild
+    work[k].w = malloc(N * sizeof *work[k].w);  // mem:mazer
+    for (i = 0; N > i; ++i) {
+      work[k].a[i] = malloc(N * sizeof *work[k].a[i]);  // mem:costrel
+      work[k].w[i] = malloc(N * sizeof *work[k].w[i]);  // mem:kirtle
+    }
+    work[k].vv = malloc(N * sizeof *work[k].vv);  // mem:gipon
+  }
+  mem_bytes += num_work * (long)(sizeof *work + 2 * N * sizeof *mya + 2 * N * N * sizeof **mya +
+                                 N * sizeof *vv);
 
   /* chop up all the quadrants with simplexes */
   /* calculate the true volume of the N-minus-1 dimensional ball */
@@ -226,8 +892,7 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
     g = prhi[j] - S[j].centerpnt;
     marg[2 * j] = f;
     marg[2 * j + 1] = g;
-    gmarg[2 * j] = gauss_integral_c(f, N);  // gauss integral thereof
-    gmarg[2 * j + 1] = gauss_integral_c(g, N);
+    vacc[2 * j] = vacc[2 * j + 1] = C->accuracy;
   }
   /* corner vectors */
   for (j = 0; num_marg > j; ++j) {
@@ -240,9 +905,10 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
   /* corner vector margins */
   for (j = 0; num_marg > j; ++j) {
     f = cmarg[j];
-    marg[j + 2 * N] = f;                        // store the value before gaussing it
-    gmarg[j + 2 * N] = gauss_integral_c(f, N);  // gauss integral thereof
+    marg[j + 2 * N] = f;  // store the value before gaussing it
+    vacc[j + 2 * N] = C->accuracy;
   }
+  gauss_integral_c_batch(marg, gmarg, num_vect, N);  // gauss integrals thereof
 
   /* print these guys to make sure it is working */
   /* printf("The vectors are:\n"); */
@@ -255,6 +921,13 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
   /* } */
 
   /* make the first simplexes t[][] */
+  /* without corner vectors, each quadrant is one simplex of its axis vectors */
+  for (k = 0; !num_marg && num_simp > k; ++k) {  // for each quadrant
+    bord(N, k, bin);
+    t_ijxn = &t[k / PAGE_LINES][(k % PAGE_LINES) * N];
+    for (j = 0; N > j; ++j)  // for each coordinate
+      t_ijxn[j] = 2 * j + bin[j];
+  }
   /* each of contains the corner vector and all axis vectors except one */
   for (k = 0; num_marg > k; ++k) {  // for each quadrant
     bord(N, k, bin);
@@ -270,7 +943,6 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
       }
     }
   }
-  num_simp = N * num_marg;  // initial number of simplexes: N*2**N
 
   /* print these guys to make sure it is working */
   /* printf("The first simplexes are:\n"); */
@@ -295,23 +967,47 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
 
   /* compute values for the initial simplexes */
   /* code is redundant with that of the do loop */
-  tm = tv = 0.0;
+  mom_grow(&mom_arena, &mem_mom_pages, mem_simp_pages, &mom);
+  clock_t clock0 = clock();
+  pass = SIMP_PASS(NEW_SHAPE, NULL);
+  simp_pass(&pass, work, num_work, total);
+  tm = total[0];
+  tv = total[1];
+  tvol = total[2];
+  svol_seconds = (double)(clock() - clock0) / CLOCKS_PER_SEC / num_simp;
+  /* store the moments, or recompute them every time */
+  /* every annealing step re-evaluates every simplex, so that is where storing pays */
+  if (C->options.y_moments < 0) {
+    long finish_simp = (long)num_simp * (anneal_iter + finish_iter) / num_vect;
+    C->options.y_moments = finish_simp * (simp_bytes + (C->options.y_store ? 0 : 24)) <=
+                               (long)C->options.y_max_mem_k * 1024 &&
+                           svol_seconds * finish_simp * STEPS > 1.0;
+  }
+  if (!C->options.y_moments) {
+    simp_free(&mom_arena, mem_mom_pages, mom, NULL);  // mem:vicarages
+    mom = NULL;
+    mem_mom_pages = 0;
+  }
+  lprintf(C, "\nSimplex volumes and moments %s (svol %.1f us)\n",
+          C->options.y_moments ? "stored" : "recomputed", 1e6 * svol_seconds);
+  fom_build(&fom, powm, num_simp);
+  inc_grow(&inc, &mem_inc, mem_vect);
   for (i = 0; num_simp > i; ++i) {
     t_ijxn = &t[i / PAGE_LINES][(i % PAGE_LINES) * N];
-    powm_ij = &powm[i / PAGE_LINES][i % PAGE_LINES];
-    volu = svol(N, p, t_ijxn, mya, myw, vv);
-    sval(N, s_gain, t_ijxn, gmarg, &mean, powm_ij, &vari, volu);
-    tm += mean;
-    tv += vari;
-  }
-  ave = tm / av;
-  sigma = sqrt(tv) / av;
+    for (j = 0; N > j; ++j)
+      inc_add(&inc[t_ijxn[j]], i);
+  }
+  ave = tm / VNORM;
+  sigma = sqrt(tv) / VNORM;
   /* print initial values */
   lprintf(C, "\nIntegrate over the quadrants for at least %d iterations\n",
           anneal_iter + finish_iter);
+  if (batch > 1)
+    lprintf(C, "Splitting up to %d simplexes at a time\n", batch);
   lprintf(C, " Points Simplexes 1-Yield                 M(sigma)  Vector\n");
   lprintf(C, "%5d %9d   %4.2e +/- %4.2e\n", num_vect, num_simp, ave, sigma);
   lprintf(C, "\ngain=%.2e\n", s_gain);
+  C->accuracy = anneal_accuracy(C, num_vect_step);
 
   /* SECRET SAUCE: */
   /* 1) select largest simplexes to bisect, either by mean or powm=mean**y_search_gain */
@@ -322,248 +1018,493 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
   /* add some new points !!! */
   do {
     if (stepping) {
-      if (num_vect == anneal_iter)
+      if (num_vect == anneal_iter) {
         stepping = 0;
+        C->accuracy = C->options.binsearch_accuracy;
+      }
       if (stepping && num_vect % num_vect_stride == 0) {
         num_vect_step = num_vect / num_vect_stride;
-        s_gain = pow((10 - WIDTH) / 10.0, STEPS - 1 - num_vect_step);
-        for (i = 0; num_simp > i; ++i) {  // refactoring powm, plus some needless work
-          t_ijxn = &t[i / PAGE_LINES][(i % PAGE_LINES) * N];
-          powm_ij = &powm[i / PAGE_LINES][i % PAGE_LINES];
-          volu = svol(N, p, t_ijxn, mya, myw, vv);  // recalculating what we did not store
-          sval(N, s_gain, t_ijxn, gmarg, &mean, powm_ij, &vari, volu);
+        /* adaptive: once the error is within y_accuracy, the rest of the schedule is skipped */
+        if (C->options.y_anneal && num_vect_step < STEPS - 1 &&
+            sigma <= ave * C->options.y_accuracy / 100.0) {
+          lprintf(C, "\n1-Yield is within %.1f%% after %d steps: annealing skipped",
+                  100 * sigma / ave, num_vect_step);
+          num_vect_step = STEPS - 1;
+          anneal_iter = num_vect + num_vect_stride;
         }
+        s_gain = pow((10 - WIDTH) / 10.0, STEPS - 1 - num_vect_step);
+        pass = SIMP_PASS(STORED, NULL);  // refactoring powm, plus some needless work
+        simp_pass(&pass, work, num_work, total);
+        fom_build(&fom, powm, num_simp);
+        C->accuracy = anneal_accuracy(C, num_vect_step);
         /* print the gain */
         lprintf(C, (s_gain >= 0.1) ? "\ngain=%.2f " : "\ngain=%.2e ", s_gain);
+        if (C->accuracy > C->options.binsearch_accuracy)
+          lprintf(C, "(binsearch %.3f) ", C->accuracy);
         if (C->options.y_print_every)
           lprintf(C, "\n");
       }
     }
-    biggest = powm[ibig = 0][jbig = 0];  // init size of the simplex with the greatest FOM
-    mylines = PAGE_LINES;
-    mypage = (num_simp - 1) / PAGE_LINES;  // this is the number of pages minus one
-    mod_mypage =
-        num_simp % PAGE_LINES;  // this is the number of entries on the remainder page, if not full
-    for (i = 0; mypage >= i; ++i) {
-      if ((mypage == i) && mod_mypage)
-        mylines = mod_mypage;  // the last page is not full
-      powm_i = powm[i];        // add a little accelerant
-      for (j = 0; mylines > j; ++j) {
-        temp = powm_i[j];
-        if (biggest < temp) {
-          biggest = temp;
-          ibig = i;
-          jbig = j;
+    /* how many to split this round: not past the end of an annealing step, nor of the budget */
+    num_batch = batch;
+    if (stepping && num_batch > num_vect_stride - num_vect % num_vect_stride)
+      num_batch = num_vect_stride - num_vect % num_vect_stride;
+    if (num_batch > max_num_vect - num_vect)
+      num_batch = max_num_vect - num_vect;
+    if (num_batch > 1 && (k = budget_fits(C, num_batch)) < num_batch)
+      num_batch = k > 1 ? k : 1;
+    /* enough memory for this round */
+    if (num_vect + num_batch > mem_vect) {  // increment the number of vectors
+      inc_vect = (mem_vect / 3 + 1 > num_batch) ? mem_vect / 3 + 1 : num_batch;  // 33% more
+      vect_grow(&mem_vect, inc_vect, N, &marg, &gmarg, &vacc, &p);
+    }
+    if (mem_inc < mem_vect)
+      inc_grow(&inc, &mem_inc, mem_vect);
+    if (C->options.y_surrogate && mem_band < mem_vect) {
+      gband = realloc(gband, mem_vect * sizeof *gband);  // mem:spurtle
+      memset(&gband[mem_band], 0, (mem_vect - mem_band) * sizeof *gband);
+      mem_bytes += (mem_vect - mem_band) * (long)sizeof *gband;
+      mem_band = mem_vect;
+    }
+    /* the simplexes with the greatest FOM, but only those that split independently */
+    for (b = 0, num_popped = 0; num_batch > b && fom.num > 0 && 4 * batch > num_popped;) {
+      k = popped[num_popped++] = fom_pop(&fom, powm);
+      t_ijxn = &t[k / PAGE_LINES][(k % PAGE_LINES) * N];
+      newv = num_vect + b;
+      if (!num_marg && is_quadrant(N, t_ijxn)) {
+        /* the orthants mesh: a quadrant gets its corner vector, as the corners mesh has it */
+        if (b > 0 && simp_conflicts(N, t_ijxn, k, edge, b))
+          continue;
+        edge[2 * b] = k;
+        edge[2 * b + 1] = -1;
+        for (j = 0; N > j; ++j)
+          p[newv][j] = 0.0;
+        for (i = 0; N > i; ++i)
+          for (j = 0; N > j; ++j)
+            p[newv][j] += p[t_ijxn[i]][j];
+        norm_v(N, p[newv]);  // normalize it
+      } else {
+        big_dist(N, p, t_ijxn, &big1,
+                 &big2);       // return the indexes of the points that are furthest apart
+        tbig1 = t_ijxn[big1];  // the actual points that are furthest apart
+        tbig2 = t_ijxn[big2];
+        if (b > 0 && edge_conflicts(N, t, inc, tbig1, tbig2, edge, b))
+          continue;
+        edge[2 * b] = tbig1;
+        edge[2 * b + 1] = tbig2;
+        /* new vector = bisect the pair */
+        for (j = 0; N > j; ++j)
+          p[newv][j] = p[tbig1][j] + p[tbig2][j];  // normalization takes care of averaging
+        norm_v(N, p[newv]);                        // normalize it
+      }
+      /* margin */
+      for (i = 0; N > i; i++)
+        direction[b * N + i] = -p[newv][i];  // direction is negative-wise!!
+      searches[b] = SEARCH_INIT(pc, &direction[b * N], &pr[b * N]);
+      /* or its prediction, if the band of its gauss integral is within y_surrogate_tol of 1-Yield:
+       * the mean weighs each vector by its share of the simplices, so neither can the sum be off by
+       * more than that */
+      use[b] = SUR_SEARCH;
+      if (C->options.y_surrogate &&
+          surrogate(N, num_vect, p, t_ijxn, marg, vacc, gband, p[newv], C->accuracy, &mu, &sd) &&
+          mu > 2.0 * sd) {
+        g = (gauss_integral_c(mu - 2.0 * sd, N) - gauss_integral_c(mu + 2.0 * sd, N)) / 2.0;
+        if (2.0 * g <= C->options.y_surrogate_tol / 100.0 * ave) {
+          use[b] = C->options.y_surrogate;
+          pred[3 * b] = mu;
+          pred[3 * b + 1] = sd;
+          pred[3 * b + 2] = g;
         }
       }
+      ++b;
     }
-
-    t_ijxn = &t[ibig][jbig * N];  // the biggest simplex is here
-    big_dist(N, p, t_ijxn, &big1,
-             &big2);       // return the indexes of the points that are furthest apart
-    tbig1 = t_ijxn[big1];  // the actual points that are furthest apart
-    tbig2 = t_ijxn[big2];
-    /* enough memory for this iteration */
-    if (num_vect == mem_vect)                                 // increment the number of vectors
-      inc_vect = mem_vect / 3 + 1;                            // 33% more
-    vect_realloc(&mem_vect, inc_vect, N, &marg, &gmarg, &p);  // mem:dissinew
-    newv = num_vect++;
-    /* new vector = bisect the pair */
-    for (j = 0; N > j; ++j)
-      p[newv][j] = p[tbig1][j] + p[tbig2][j];  // normalization takes care of averaging
-    norm_v(N, p[newv]);                        // normalize it
-    /* margin */
-    for (i = 0; N > i; i++) {
-      pc[i] = S[i].centerpnt;      // initialize
-      direction[i] = -p[newv][i];  // direction is negative-wise!!
-    }
-    if ((f = addpoint_corners(C, S, NULL, pr, pc, direction)) == 0.0) {
-      fprintf(stderr, "Circuit failed for nominal parameter values\n");
-      ret = 0;
-      goto cleanup;
-    }
-    marg[newv] = f;                        // store its value before gaussing it
-    gmarg[newv] = gauss_integral_c(f, N);  // gauss integral thereof
-
-    /* for every simplex containing the pair, we should make two new ones */
-    /* find all simplexes containing this point pair */
-    mean_old = mean_new = vari_old = vari_new = 0.0;
-    /* search the unordered list. make it fast */
-    /* virtual nested for loop across i simplexes of j dimensions */
-
-    mylines = N * PAGE_LINES;
-    mypage = (num_simp - 1) / PAGE_LINES;  // this is the number of pages minus one
-    mod_mypage =
-        N * (num_simp %
-             PAGE_LINES);  // this is the number of entries on the remainder page, if not full
-    for (i = 0; mypage >= i; ++i) {
-      if ((mypage == i) && mod_mypage)
-        mylines = mod_mypage;  // the last page is not full
-      t_i = t[i];              // add a little accelerant
-      for (j = 0; mylines > j; ++j) {
-        if (tbig1 == t_i[j]) {
-          r = j / N;           // the virtual row within this page
-          rxn = r * N;         // first element of the row
-          j1 = j - rxn;        // matched one in the virtual column, aka j1=j%N
-          j = rxn + nm1;       // break out to the next row...minus one
-          t_ijxn = &t_i[rxn];  // accelerate the m loop
-          for (m = 0; N > m; ++m) {
-            if (tbig2 == t_ijxn[m]) {
-              j2 = m;   // matched the other in the virtual column
-              m = nm1;  // break out of the m loop
-              /* enough memory for this iteration */
-              if (num_simp == mem_simp) {                                     // make more memory
-                inc_simp_pages = mem_simp_pages / 3 + 1;                      // 30% more
-                simp_realloc(&mem_simp_pages, inc_simp_pages, &powm, &t, N);  // mem:enjoined
-                mem_simp = mem_simp_pages * PAGE_LINES;
-                /* t_i = t[i]; */  // this refresh is not needed cause pages are for forever
-              }
-              news = num_simp++;
-              /* evaluate the old simplex in terms of mean, variance, and volume */
-              t_ijxn = &t[i][rxn];                                       // the old location
-              powm_ij = &powm[i][r];                                     // the old location
-              t_ijxn2 = &t[news / PAGE_LINES][(news % PAGE_LINES) * N];  // the new location
-              powm_ij2 = &powm[news / PAGE_LINES][news % PAGE_LINES];    // the new location
-              /* the old */
-              volu = svol(N, p, t_ijxn, mya, myw, vv);  // recalculating what we did not store
-              sval(N, s_gain, t_ijxn, gmarg, &mean, powm_ij, &vari, volu);
-              mean_old += mean;  // minus
-              vari_old += vari;
-              /* make the new simplexes */
-              for (k = 0; N > k; ++k) {
-                t_ijxn2[k] = t_ijxn[k];  // copy out the simplex to the end of the list
-              }
-              t_ijxn[j1] = newv;   // edit the old
-              t_ijxn2[j2] = newv;  // and the new
-              /* evaluate the new simplexes in terms of mean, variance, and volume */
-              /* the new at the old location */
-              volu = svol(N, p, t_ijxn, mya, myw, vv);
-              sval(N, s_gain, t_ijxn, gmarg, &mean, powm_ij, &vari, volu);
-              mean_new += mean;  // plus
-              vari_new += vari;
-              /* the new at the new location */
-              volu = svol(N, p, t_ijxn2, mya, myw, vv);
-              sval(N, s_gain, t_ijxn2, gmarg, &mean, powm_ij2, &vari, volu);
-              mean_new += mean;  // plus
-              vari_new += vari;
-            }
+    num_batch = b;
+    while (num_popped > 0)
+      fom_push(&fom, powm, popped[--num_popped]);
+    for (i = 0; N > i; i++)
+      pc[i] = S[i].centerpnt;  // initialize
+    /* all the searches, and the point-checks of the predictions to verify at their lower bound */
+    for (b = 0, num_run = 0; num_batch > b; ++b) {
+      if (use[b] == SUR_SKIP)
+        continue;
+      run[num_run] = searches[b];
+      if (use[b] == SUR_VERIFY) {
+        double *v = &vpc[b * (N + C->num_params_corn)];
+        for (i = 0; N + C->num_params_corn > i; ++i)
+          v[i] = pc[i];
+        for (i = 0; N > i; ++i)
+          v[i] -= (pred[3 * b] - 2.0 * pred[3 * b + 1]) * direction[b * N + i];
+        run[num_run] = SEARCH_INIT(v, NULL, NULL);
+      }
+      run_b[num_run++] = b;
+    }
+    sims0 = budget_sims();
+    addpoint_batch(C, S, run, num_run, NULL, NULL);
+    /* a prediction that fails its point-check is searched after all */
+    for (k = 0, num_again = 0; num_run > k; ++k) {
+      b = run_b[k];
+      if (use[b] == SUR_SEARCH) {
+        searches[b] = run[k];
+      } else if (run[k].margin == 0.0) {
+        use[b] = SUR_SEARCH;
+        ++sur_refuted;
+        run_b[num_run + num_again++] = b;
+      } else {
+        verify_sims += corners_per_search(C);
+      }
+    }
+    for (k = 0; num_again > k; ++k)
+      run[k] = searches[run_b[num_run + k]];
+    addpoint_batch(C, S, run, num_again, NULL, NULL);
+    for (k = 0; num_again > k; ++k)
+      searches[run_b[num_run + k]] = run[k];
+    for (b = 0; num_batch > b; ++b) {
+      if (use[b] != SUR_SEARCH) {
+        searches[b].margin = pred[3 * b];
+        for (i = 0; N > i; i++)
+          pr[b * N + i] = pc[i] - pred[3 * b] * direction[b * N + i];
+      } else if (searches[b].margin == 0.0) {
+        fprintf(stderr, "Circuit failed for nominal parameter values\n");
+        ret = 0;
+        goto cleanup;
+      } else {
+        ++num_searched;
+      }
+    }
+    search_sims += budget_sims() - sims0;
+
+    /* split them in the order they were chosen, as if one at a time */
+    for (b = 0; num_batch > b && !stop; ++b) {
+      tbig1 = edge[2 * b];
+      tbig2 = edge[2 * b + 1];
+      newv = num_vect++;
+      f = searches[b].margin;
+      marg[newv] = f;                        // store its value before gaussing it
+      gmarg[newv] = gauss_integral_c(f, N);  // gauss integral thereof
+      vacc[newv] = C->accuracy;
+      if (gband)
+        gband[newv] = (use[b] != SUR_SEARCH) ? pred[3 * b + 2] : 0.0;
+
+      /* for every simplex containing the pair, we should make two new ones */
+      /* (and for a quadrant, N new ones around its corner vector) */
+      mean_old = mean_new = vari_old = vari_new = vol_old = vol_new = 0.0;
+      k = (tbig2 < 0) ? 1 : inc[tbig1].num;  // the simplexes to split are among these
+      if (num_pair < k) {
+        mem_bytes += (k - num_pair) * (long)sizeof *pair;
+        pair = realloc(pair, (num_pair = k) * sizeof *pair);  // mem:wanhope
+      }
+      if (tbig2 < 0) {
+        pair[0] = tbig1;
+        k = 1;
+      } else {
+        /* find all simplexes containing this point pair, by way of the simplexes of one point */
+        /* the simplexes of tbig1 that also have tbig2, in the order they are stored */
+        for (m = 0, k = 0; inc[tbig1].num > m; ++m) {
+          r = inc[tbig1].simp[m];
+          t_ijxn = &t[r / PAGE_LINES][(r % PAGE_LINES) * N];
+          for (j = 0; N > j; ++j)
+            if (tbig2 == t_ijxn[j])
+              pair[k++] = r;
+        }
+        qsort(pair, k, sizeof *pair, by_index);
+      }
+      for (m = 0; k > m; ++m) {
+        i = pair[m] / PAGE_LINES;  // the page
+        r = pair[m] % PAGE_LINES;  // the row within this page
+        rxn = r * N;               // first element of the row
+        t_ijxn = &t[i][rxn];
+        if (tbig2 < 0) {
+          j1 = 0;  // the old keeps all but its first point, and the copies all but one other
+          num_copy = N - 1;
+        } else {
+          for (j = 0; N > j; ++j) {
+            if (tbig1 == t_ijxn[j])
+              j1 = j;  // matched one in the virtual column
+            if (tbig2 == t_ijxn[j])
+              j2 = j;  // matched the other
+          }
+          num_copy = 1;
+        }
+        /* enough memory for this iteration */
+        if (num_simp + num_copy > mem_simp) {  // make more memory
+          inc_simp_pages = mem_simp_pages / 3 + 1;  // 30% more
+          /* but no more than fits in y_max_mem_k, past the page this simplex needs */
+          page_bytes = PAGE_LINES * (long)(2 * sizeof *fom.heap);
+          if (!C->options.y_store)
+            page_bytes += PAGE_LINES * (long)(sizeof **powm + N * sizeof **t +
+                                              (mom ? 3 * sizeof **mom : 0));
+          if (inc_simp_pages > (max_mem - mem_bytes) / page_bytes)
+            inc_simp_pages = (max_mem - mem_bytes) / page_bytes > 1
+                                 ? (max_mem - mem_bytes) / page_bytes
+                                 : 1;
+          simp_grow(&simp_arena, &mem_simp_pages, inc_simp_pages, &powm, &t, N);
+          mem_simp = mem_simp_pages * PAGE_LINES;
+          fom_grow(&fom, mem_simp);
+          if (mom)
+            mom_grow(&mom_arena, &mem_mom_pages, mem_simp_pages, &mom);
+        }
+        news = num_simp;
+        num_simp += num_copy;
+        /* evaluate the old simplex in terms of mean, variance, and volume */
+        powm_ij = &powm[i][r];  // the old location
+        /* the old */
+        vol_old += seval(N, s_gain, p, t_ijxn, gmarg, mya, myw, vv, MOM(pair[m]), STORED, &mean,
+                         powm_ij, &vari);
+        mean_old += mean;  // minus
+        vari_old += vari;
+        /* make the new simplexes */
+        for (c = 0; num_copy > c; ++c) {
+          t_ijxn2 = &t[(news + c) / PAGE_LINES][((news + c) % PAGE_LINES) * N];  // the new location
+          for (j = 0; N > j; ++j) {
+            t_ijxn2[j] = t_ijxn[j];  // copy out the simplex to the end of the list
           }
+          t_ijxn2[tbig2 < 0 ? c + 1 : j2] = newv;  // edit the new
+          for (j = 0; N > j; ++j)
+            inc_add(&inc[t_ijxn2[j]], news + c);
+        }
+        /* the old one moves from its point j1 to newv */
+        inc_remove(&inc[t_ijxn[j1]], pair[m]);
+        inc_add(&inc[newv], pair[m]);
+        t_ijxn[j1] = newv;  // edit the old
+        /* evaluate the new simplexes in terms of mean, variance, and volume */
+        /* the new at the old location */
+        vol_new += seval(N, s_gain, p, t_ijxn, gmarg, mya, myw, vv, MOM(pair[m]), NEW_SHAPE, &mean,
+                         powm_ij, &vari);
+        mean_new += mean;  // plus
+        vari_new += vari;
+        /* the new at the new location */
+        for (c = 0; num_copy > c; ++c) {
+          t_ijxn2 = &t[(news + c) / PAGE_LINES][((news + c) % PAGE_LINES) * N];
+          powm_ij2 = &powm[(news + c) / PAGE_LINES][(news + c) % PAGE_LINES];
+          vol_new += seval(N, s_gain, p, t_ijxn2, gmarg, mya, myw, vv, MOM(news + c), NEW_SHAPE,
+                           &mean, powm_ij2, &vari);
+          mean_new += mean;  // plus
+          vari_new += vari;
         }
+        /* all have a new FOM */
+        fom_update(&fom, powm, pair[m]);
+        for (c = 0; num_copy > c; ++c)
+          fom_push(&fom, powm, news + c);
       }
-    }
 
-    /* compile this iteration for printing purposes */
-    /* updating these quantities by adding the new and subtracting the old, for efficiency */
-    /* the answer may drift as a result, but it is harmless cause you do it for real at the end */
-    tm += (mean_new - mean_old);
-    tv += (vari_new - vari_old);
-    /* compute mean and varience, but report mean and sigma */
-    /* weight the result by the volume of the hypershpere av */
-    ave = tm / av;
-    sigma = sqrt(tv) / av;
-    /* print */
-    /* see if it is a new record */
-    small_print_old = small_print;
-    small_print = 0;
-    if (smaller > marg[newv]) {
-      smaller = marg[newv];
-      small_print = 1;
-    }
-    /* print a line */
-    if (!small_print && !C->options.y_print_every) {
-      lprintf(C, ".");
-    } else {
-      if (!small_print_old && !C->options.y_print_every) {
+      /* compile this iteration for printing purposes */
+      /* updating these quantities by adding the new and subtracting the old, for efficiency */
+      /* the answer may drift as a result, but it is harmless cause you do it for real at the
+       * end */
+      tm += (mean_new - mean_old);
+      tv += (vari_new - vari_old);
+      tvol += (vol_new - vol_old);
+      /* compute mean and varience, but report mean and sigma */
+      /* weight the result by the volume of the hypershpere av */
+      ave = tm / VNORM;
+      sigma = sqrt(tv) / VNORM;
+      /* print */
+      /* see if it is a new record */
+      small_print_old = small_print;
+      small_print = 0;
+      if (smaller > marg[newv]) {
+        smaller = marg[newv];
+        small_print = 1;
+      }
+      /* print a line */
+      if (!small_print && !C->options.y_print_every) {
+        lprintf(C, ".");
+      } else {
+        if (!small_print_old && !C->options.y_print_every) {
+          lprintf(C, "\n");
+        }
+        lprintf(C, "%5d %9d   %4.2e +/- %4.2e", newv + 1, num_simp, ave, sigma);
+        /* print margin in units of sigma, marked if predicted */
+        lprintf(C, "   %7.2f%s   ", marg[newv], use[b] != SUR_SEARCH ? "~" : " ");
+        /* print parameter vector */
+        for (i = 0; i < N; i++) {
+          lprintf(C, "%6.3f%s",
+                  -searches[b].direction[i],  // direction is negative-wise!!
+                  (searches[b].pr[i] <= C->params[i].min || searches[b].pr[i] >= C->params[i].max)
+                      ? "*"
+                      : " ");
+        }
         lprintf(C, "\n");
       }
-      lprintf(C, "%5d %9d   %4.2e +/- %4.2e", newv + 1, num_simp, ave, sigma);
-      /* print margin in units of sigma */
-      lprintf(C, "   %7.2f    ", marg[newv]);
-      /* print parameter vector */
-      for (i = 0; i < N; i++) {
-        lprintf(C, "%6.3f%s",
-                -direction[i],  // direction is negative-wise!!
-                (pr[i] <= C->params[i].min || pr[i] >= C->params[i].max) ? "*" : " ");
+      /* check if loop should terminate */
+      /* maximum memory */
+      if (!stop && mem_bytes > max_mem) {
+        stop = 1;
+        lprintf(C,
+                "\nMemory usage has reached the limit of y_max_mem_k = %d [KiB]\n\nIntegration "
+                "Interrupted\n\n",
+                C->options.y_max_mem_k);
+      }
+      /* maximum iterations */
+      if (!stop && num_vect == max_num_vect) {
+        stop = 1;
+        lprintf(C,
+                "\nIterations has reached the internal limit of %d\n\nIntegration "
+                "Interrupted\n\n",
+                max_num_vect);
       }
-      lprintf(C, "\n");
-    }
-    /* check if loop should terminate */
-    /* maximum memory */
-    if (!stop && num_simp > max_num_simp) {
-      stop = 1;
-      lprintf(C,
-              "\nMemory usage has reached the limit of y_max_mem_k = %d [KiB]\n\nIntegration "
-              "Interrupted\n\n",
-              C->options.y_max_mem_k);
-    }
-    /* maximum iterations */
-    if (!stop && num_vect == max_num_vect) {
-      stop = 1;
-      lprintf(C, "\nIterations has reached the internal limit of %d\n\nIntegration Interrupted\n\n",
-              max_num_vect);
-    }
-    /* ITERATE file gone */
-    if (!stop && !checkiter(C)) {
-      stop = 1;
-    }
-    /* result is stable after we have met the minimum */
-    if (!stop && (num_vect >= (anneal_iter + finish_iter))) {
-      /* find max and min during the last finish_iter iterations */
-      itmax = itmin = ave;
-      for (j = 0; finish_iter > j; ++j) {
-        if (itmax < improve[j])
-          itmax = improve[j];
-        if (itmin > improve[j])
-          itmin = improve[j];
-      }
-      /* y_accuracy is a percentage now */
-      if ((itmax / ave - 1.0) < (C->options.y_accuracy / 100.0) &&
-          (1.0 - itmin / ave) < (C->options.y_accuracy / 100.0)) {
+      /* ITERATE file gone */
+      if (!stop && !checkiter(C)) {
+        stop = 1;
+      }
+      /* the next vector would not fit in the simulation budget */
+      if (!stop && b == num_batch - 1 && !budget_allows(C, 1)) {
+        stop = over_budget = 1;
+        lprintf(C, "\nIntegration Interrupted\n\n");
+      }
+      /* the standard error is small enough, once past the annealing */
+      if (!stop && !stepping && (C->options.y_stderr > 0.0 || C->options.y_confidence > 0.0) &&
+          (C->options.y_stderr <= 0.0 || sigma <= C->options.y_stderr) &&
+          (C->options.y_confidence <= 0.0 ||
+           1.96 * sigma <= ave * C->options.y_confidence / 100.0)) {
         stop = 1;
         lprintf(C,
-                "\nResult is stable to within y_accuracy=%.2f%% in the last %d "
-                "iterations\nIntegration Complete\n",
-                C->options.y_accuracy, finish_iter);
+                "\nStandard error of 1-Yield is %.2e, 95%% confidence +/- %.1f%%\nIntegration "
+                "Complete\n",
+                sigma, 100 * 1.96 * sigma / ave);
       }
+      /* result is stable after we have met the minimum */
+      if (!stop && (num_vect >= (anneal_iter + finish_iter))) {
+        /* find max and min during the last finish_iter iterations */
+        itmax = itmin = ave;
+        for (j = 0; finish_iter > j; ++j) {
+          if (itmax < improve[j])
+            itmax = improve[j];
+          if (itmin > improve[j])
+            itmin = improve[j];
+        }
+        /* y_accuracy is a percentage now */
+        if ((itmax / ave - 1.0) < (C->options.y_accuracy / 100.0) &&
+            (1.0 - itmin / ave) < (C->options.y_accuracy / 100.0)) {
+          stop = 1;
+          lprintf(C,
+                  "\nResult is stable to within y_accuracy=%.2f%% in the last %d "
+                  "iterations\nIntegration Complete\n",
+                  C->options.y_accuracy, finish_iter);
+        }
+      }
+      improve[num_vect % finish_iter] = ave;
     }
-    improve[num_vect % finish_iter] = ave;
   } while (!stop);
+  /* refine the coarse vectors of the simplexes that dominate the error (not the predicted ones,
+   * which were sure enough already) */
+  C->accuracy = C->options.binsearch_accuracy;
+  for (k = 0, j = 0; num_vect > k; ++k)
+    j += (vacc[k] > C->accuracy && !(gband && gband[k] > 0.0));
+  if (j > 0) {
+    /* the error attributed to each vector */
+    double *verr = calloc(num_vect, sizeof *verr);  // mem:gloaming
+    for (i = 0; num_simp > i; ++i) {
+      t_ijxn = &t[i / PAGE_LINES][(i % PAGE_LINES) * N];
+      seval(N, s_gain, p, t_ijxn, gmarg, mya, myw, vv, MOM(i), STORED, &mean, &temp, &vari);
+      for (k = 0; N > k; ++k)
+        verr[t_ijxn[k]] += vari;
+    }
+    /* a vector dominates if it carries more than its share of the total variance */
+    int *refine = malloc(num_vect * sizeof *refine);  // mem:drookit
+    for (m = 0, k = 0; num_vect > k; ++k)
+      if (vacc[k] > C->accuracy && !(gband && gband[k] > 0.0) && verr[k] * num_vect > tv)
+        refine[m++] = k;
+    free(verr);  // mem:gloaming
+    /* as many at once as the budget allows */
+    if (over_budget) {
+      m = 0;
+    } else if ((k = budget_fits(C, m)) < m) {
+      budget_allows(C, k + 1);  // to say why
+      m = k;
+    }
+    for (i = 0; N > i; i++)
+      pc[i] = S[i].centerpnt;
+    Search *refines = malloc(m * sizeof *refines);            // mem:haar
+    double *directions = malloc(m * N * sizeof *directions);  // mem:smirr
+    for (b = 0; m > b; ++b) {
+      for (i = 0; N > i; i++)
+        directions[b * N + i] = -p[refine[b]][i];  // direction is negative-wise!!
+      refines[b] = SEARCH_INIT(pc, &directions[b * N], NULL);
+    }
+    addpoint_batch(C, S, refines, m, NULL, NULL);
+    for (b = 0; m > b; ++b) {
+      k = refine[b];
+      if ((f = refines[b].margin) != 0.0) {
+        marg[k] = f;
+        gmarg[k] = gauss_integral_c(f, N);
+      }
+      vacc[k] = C->accuracy;
+    }
+    free(refines);     // mem:haar
+    free(directions);  // mem:smirr
+    free(refine);      // mem:drookit
+    /* and do the totals for real */
+    pass = SIMP_PASS(NEW_MARGINS, NULL);
+    simp_pass(&pass, work, num_work, total);
+    tm = total[0];
+    tv = total[1];
+    tvol = total[2];
+    ave = tm / VNORM;
+    sigma = sqrt(tv) / VNORM;
+    lprintf(C, "\nRefined %d of %d coarse vectors at binsearch_accuracy=%.3f\n", m, j,
+            C->accuracy);
+  }
   /* last line */
   lprintf(C, "%5d %9d   %4.2e +/- %4.2e\n", num_vect, num_simp, ave, sigma);
+  if (over_budget) {
+    /* the estimate is only as good as it got: say how good */
+    lprintf(C, "\nStopped at 1-Yield = %.2e, 95%% confidence %.2e to %.2e\n", ave,
+            (ave > 1.96 * sigma) ? ave - 1.96 * sigma : 0.0, ave + 1.96 * sigma);
+  }
+  screen_check(C, ave);
+  budget_report(C);
+  if (gband) {
+    /* the error the predictions may have made, integrated as the gauss integrals are */
+    double *band7[7];
+    for (j = 0; 7 > j; ++j)
+      band7[j] = gband;
+    pass = SIMP_PASS(STORED, band7);
+    simp_pass(&pass, work, num_work, total);
+    for (k = 0, m = 0; num_vect > k; ++k)
+      m += (gband[k] > 0.0);
+    /* each prediction saved a search, less its point-check */
+    lprintf(C,
+            "Surrogate: %d of %d vectors predicted (%ld refuted by their point-check), about %.0f "
+            "simulations saved\n1-Yield error bound of the predictions: +/- %.2e\n",
+            m, num_vect, sur_refuted,
+            num_searched ? (double)m * (search_sims - verify_sims) / num_searched - verify_sims
+                         : 0.0,
+            total[3] / VNORM);
+  }
 
   /* quote 1-yield here at the end for various factors of increased sigma to account for BER */
   /* some temp storage */
-  double **gmarg7 = malloc(7 * sizeof *gmarg7);  // free me...but only if you get this far
+  double **gmarg7 = malloc(7 * sizeof *gmarg7);  // mem:scantling
   for (i = 0; 7 > i; ++i) {
-    gmarg7[i] = malloc(num_vect * sizeof *gmarg7[i]);  // free me...but only if you get this far
+    gmarg7[i] = malloc(num_vect * sizeof *gmarg7[i]);  // mem:dottrel
   }
-  ts = 0.0;
   for (j = 0; 7 > j; ++j) {
-    tm7[j] = tv7[j] = 0.0;
     scale7[j] = pow(2, j / 2.0 - 1.0);  // scaling by 0.5, 0.707, 1, 1.414, 2, 2.828, 4
+    /* recalculating gmarg from scaled marg */
     for (k = 0; num_vect > k; ++k) {
-      gmarg7[j][k] =
-          gauss_integral_c(marg[k] / scale7[j], N);  // recalculating gmarg from scaled marg
+      gmarg7[j][k] = marg[k] / scale7[j];
     }
+    gauss_integral_c_batch(gmarg7[j], gmarg7[j], num_vect, N);
   }
-  for (i = 0; num_simp > i; ++i) {  // recalculating each simplex integral from gmarg
-    t_ijxn = &t[i / PAGE_LINES][(i % PAGE_LINES) * N];
-    volu = svol(N, p, t_ijxn, mya, myw, vv);  // recalculating what we did not store
-    ts += volu;
-    for (j = 0; 7 > j; ++j) {
-      sval(N, s_gain, t_ijxn, gmarg7[j], &mean7, &powm7, &vari, volu);
-      tm7[j] += mean7;
-      tv7[j] += vari;
-    }
+  pass = SIMP_PASS(STORED, gmarg7);  // recalculating each simplex integral from gmarg
+  simp_pass(&pass, work, num_work, total);
+  ts = total[2];
+  for (j = 0; 7 > j; ++j) {
+    tm7[j] = total[3 + j];
+    tv7[j] = total[10 + j];
+    free(gmarg7[j]);  // mem:dottrel
   }
+  free(gmarg7);  // mem:scantling
   for (j = 0; 7 > j; ++j) {
-    ave7[j] = tm7[j] / av;
-    sigma7[j] = sqrt(tv7[j]) / av;
+    ave7[j] = tm7[j] / (N > SVOL_FIT ? ts : av);
+    sigma7[j] = sqrt(tv7[j]) / (N > SVOL_FIT ? ts : av);
   }
 
   /* some diagnostics */
-  lprintf(C, "\nMemory Used: %ld KiB\n",
-          ((long)num_simp * (long)simp_bytes) / 1024 + 1);  // go long
+  lprintf(C, "\nMemory Used: %ld KiB\n", mem_bytes / 1024 + 1);
+  if (C->options.y_store)
+    lprintf(C, "Simplex pages mapped from _malt: %ld KiB\n", file_bytes / 1024 + 1);
   lprintf(C, "Numerical & Analytic Unit Hypersphere Volume: %5.3f & %5.3f\n", ts, av);
   /* final answer */
   lprintf(C, "\nRecalculate yield for scaled sigma values\n");
@@ -575,17 +1516,43 @@ static int cropc(Configuration *C, const Space *S, double *cmarg, int *bin, cons
 cleanup:
   free(pc);         // mem:personifications
   free(direction);  // mem:russe
-  free(pr);
-  free(improve);                        // mem:knackwursts
-  vect_free(mem_vect, marg, gmarg, p);  // mem:dissinew
-  simp_free(mem_simp_pages, powm, t);   // mem:enjoined
+  free(pr);         // mem:tamarau
+  free(searches);   // mem:unbuttered
+  free(edge);       // mem:quaich
+  free(popped);     // mem:bodach
+  free(use);        // mem:corbie
+  free(pred);       // mem:sgian
+  free(vpc);        // mem:tappit
+  free(run);        // mem:clachan
+  free(run_b);      // mem:kailyard
+  free(gband);      // mem:spurtle
+  free(improve);    // mem:flitch
+  vect_free(mem_vect, marg, gmarg, vacc, p);
+  simp_free(&simp_arena, mem_simp_pages, powm, t);
+  simp_free(&mom_arena, mem_mom_pages, mom, NULL);  // mem:vicarages
+  free(fom.heap);                                   // mem:scrobicule
+  free(fom.pos);                                    // mem:bathybius
+  for (i = 0; mem_inc > i; ++i)
+    free(inc[i].simp);  // mem:yokefellow
+  free(inc);   // mem:gravimeter
+  free(pair);  // mem:wanhope
   for (i = 0; N > i; ++i) {
     free(mya[i]);  // mem:renderer
-    free(myw[i]);  // mem:renderer
+    free(myw[i]);  // mem:rumbelow
   }
   free(mya);  // mem:outguessing
-  free(myw);  // mem:outguessing
+  free(myw);  // mem:pigsney
   free(vv);   // mem:crumpling
+  for (k = 1; num_work > k; ++k) {
+    for (i = 0; N > i; ++i) {
+      free(work[k].a[i]);  // mem:costrel
+      free(work[k].w[i]);  // mem:kirtle
+    }
+    free(work[k].a);   // mem:wergild
+    free(work[k].w);   // mem:mazer
+    free(work[k].vv);  // mem:gipon
+  }
+  free(work);  // mem:overhale
 
   return ret;
 }
@@ -604,15 +1571,13 @@ int marg_corners(Configuration *C)
   makeiter(C, 'y');
   /* create pname file */
   pname(C);
-  /* Total number of corner margins is 2^N */
-  num_marg = 1 << N;
   /* Memory allocation */
-  int *bin = malloc(N * sizeof *bin);                // mem:perendure
-  double *cmarg = malloc(num_marg * sizeof *cmarg);  // mem:airposts
-  double *y_m = malloc(num_marg * sizeof *y_m);      // mem:unalive
-  double *y_v = malloc(num_marg * sizeof *y_v);      // mem:habilitator
-  double *prlo = malloc(N * sizeof *prlo);
-  double *prhi = malloc(N * sizeof *prhi);
+  int *bin = malloc(N * sizeof *bin);  // mem:perendure
+  double *cmarg = NULL, *y_m = NULL, *y_v = NULL, *dirs = NULL, *prs = NULL;
+  double *prlo = malloc(N * sizeof *prlo);                     // mem:stravaig
+  double *prhi = malloc(N * sizeof *prhi);                     // mem:fankle
+  double *pc = malloc((N + C->num_params_corn) * sizeof *pc);  // mem:syntagma
+  Search *corners = NULL;
 
   /* Exceptions */
   if (DEPTH < 0 || DEPTH > 30) {
@@ -632,30 +1597,57 @@ int marg_corners(Configuration *C)
     all_good = 0;
     goto cleanup;
   }
-  if (N > 10) {
-    fprintf(stderr, "%d non-corner parameters is greater than the upper limit of 10\n", N);
+  if (N > 30) {
+    fprintf(stderr, "%d non-corner parameters is greater than the upper limit of 30\n", N);
     all_good = 0;
     goto cleanup;
   }
 
-  /* do the 2N on-axis margins */
-  /* They are saved in prlo and prhi, so we can reuse them */
   /* this flag checks that nominal passes when doing margins */
   C->func_init = 1;
-  if (!margins(C, S, prlo, prhi)) {
+  /* screening takes the 1D margins first, and leaves fewer corner margins */
+  if (C->options.y_screen > 0.0 && (!margins(C, S, prlo, prhi) ||
+                                    !screen(C, S, prlo, prhi, C->options.y_screen,
+                                            C->options.y_screen_dirs))) {
+    all_good = 0;
+    goto cleanup;
+  }
+  /* the corners mesh takes all 2^N corner margins, which is too many past 10 parameters */
+  if (C->options.y_mesh < 0)
+    C->options.y_mesh = (N > 10);
+  /* Total number of corner margins is 2^N, unless the mesh starts from the orthants */
+  num_marg = C->options.y_mesh ? 0 : 1 << N;
+  cmarg = malloc(num_marg * sizeof *cmarg);      // mem:airposts
+  y_m = malloc(num_marg * sizeof *y_m);          // mem:unalive
+  y_v = malloc(num_marg * sizeof *y_v);          // mem:habilitator
+  dirs = malloc(num_marg * N * sizeof *dirs);    // mem:rebuffing
+  prs = malloc(num_marg * N * sizeof *prs);      // mem:pinyons
+  corners = malloc(num_marg * sizeof *corners);  // mem:gowpens
+
+  /* do the 2N on-axis margins and all 2^N corner margins, as one batch */
+  /* They are saved in prlo and prhi, so we can reuse them */
+  for (i = 0; N + C->num_params_corn > i; i++) {
+    pc[i] = S[i].centerpnt;
+  }
+  for (i = 0; num_marg > i; ++i) {
+    corners[i] = corn_search(N, i, bin, pc, dirs, prs);
+  }
+  if (C->options.y_screen > 0.0) {
+    addpoint_batch(C, S, corners, num_marg, NULL, NULL);
+  } else if (!margins_and(C, S, prlo, prhi, corners, num_marg)) {
     /* margins errors out if N == 0 */
     all_good = 0;
     goto cleanup;
   }
   /* this flag stops checking nominal for the rest of the sim */
   C->func_init = 0;
-  /* do all 2^N corner margins */
-  if (!corn(C, S, num_marg, bin, cmarg)) {
+  /* print the corner margins */
+  if (num_marg && !corn(C, S, num_marg, bin, cmarg, corners)) {
     all_good = 0;
     goto cleanup;
   }
   /* find the critical corner margin */
-  smallest = cmarg[jc = 0];
+  smallest = num_marg ? cmarg[jc = 0] : 0.0;
   for (i = 1; num_marg > i; ++i) {
     temp = cmarg[i];  // the simplex with smallest marg
     if (smallest > temp) {
@@ -668,7 +1660,7 @@ int marg_corners(Configuration *C)
     /* don't call cropc if num_params = 1 */
     lprintf(C, "Only one included parameter. Nothing more to do here.\n");
     goto cleanup;
-  } else if (!cropc(C, S, cmarg, bin, prhi, prlo)) {
+  } else if (!cropc(C, S, cmarg, bin, prlo, prhi)) {
     all_good = 0;
     goto cleanup;
   }
@@ -676,13 +1668,23 @@ int marg_corners(Configuration *C)
 cleanup:
   unlink(C->file_names.iter);
   unlink_pname(C);
-  free(S);  // mem:appal
+  free(corners);  // mem:gowpens
+  free(prs);      // mem:pinyons
+  free(dirs);     // mem:rebuffing
+  free(y_v);      // mem:habilitator
+  free(y_m);      // mem:unalive
+  free(cmarg);    // mem:airposts
+  free(pc);       // mem:syntagma
+  free(prhi);     // mem:fankle
+  free(prlo);     // mem:stravaig
+  free(bin);      // mem:perendure
+  free(S);        // mem:appal
   return (all_good);
 }
 
 /* integrate over all quadrants to determine yield */
 /* find the pair of points with greatest distance between them and return said distance */
-static double big_dist(int dim, double **p, short *t, int *bigi, int *bigj)
+static double big_dist(int dim, double **p, vertex_t *t, int *bigi, int *bigj)
 {
   int i, j, k;
   double dist, temp, bigdist = 0.0;
@@ -734,13 +1736,11 @@ static void norm_v(int dim, double *v)
 }
 
 /* simplex volume */
-static double svol(int dim, double **p, short *tt, double **a, double **w, double *vv)
+static double svol(int dim, double **p, vertex_t *tt, double **a, double **w, double *vv)
 {
   int i, j, k;
   double d, vol, volv, volu;
   double temp;
-  // x =           0  1  2  3   4    5    6     7      8       9       10
-  double fact[] = {1, 1, 2, 6, 24, 120, 720, 5040, 40320, 362880, 3628800};  // yes really
   // clang-format off
   // N =             0    1    2    3        4        5        6        7        8        9       10
   double vfit[] = {0.0, 0.0, 0.0, 0.0, -0.0997, -0.1106, -0.1057, -0.0978, -0.0888, -0.0808, -0.0711};
@@ -766,7 +1766,7 @@ static double svol(int dim, double **p, short *tt, double **a, double **w, doubl
   for (j = 0; dim > j; ++j) {
     d *= w[j][j];
   }
-  vol = fabs(d) / fact[dim];
+  vol = fabs(d) / factrl(dim);
 
   // 1. volv
   /* use the center of each N-1 simplex to compute */
@@ -788,7 +1788,7 @@ static double svol(int dim, double **p, short *tt, double **a, double **w, doubl
   for (j = 0; dim > j; ++j) {
     d *= w[j][j];
   }
-  volv = fabs(d) / fact[dim];
+  volv = fabs(d) / factrl(dim);
   /* volumizer correction for the factor by which the reduction of the simplex reduces */
   volv *= pow((dim - 1), (dim - 1));  // crazy but true
 
@@ -840,19 +1840,38 @@ static double svol(int dim, double **p, short *tt, double **a, double **w, doubl
   /* vfit=-0.0711; // 1.46602 */
   /* [but it dips down to 1.02956 on iteration 27] */
 
-  volu = volv * pow(volv / vol, vfit[dim]);
+  /* Past N=10 there is no fit: carry on the way it was going from N=8 to 10, about +0.009 per
+   * dimension, up to no correction at all from N=18. The totals are normalized by the sum of the
+   * volumes there (VNORM), so the exponent only weighs the simplexes against one another, and
+   * little: on an 11-parameter test, -0.062 (this), -0.071 (vfit[10]) and 0 give the same 1-Yield,
+   * 2.61e-01 +/- 3.4e-04, though the unit hypersphere comes to 2.10, 1.95 and 3.52 of 1.88. */
+  temp = (dim <= SVOL_FIT) ? vfit[dim]
+                           : fmin(0.0, vfit[10] + (vfit[10] - vfit[8]) / 2 * (dim - SVOL_FIT));
+  volu = volv * pow(volv / vol, temp);
 
   return volu;
 }
 
 /* simplex mean and variance, and powm, all weighted by volume */
-static void sval(int dim, double s_gain, short *tt, double *gmarg, double *mean, double *powm,
+static void sval(int dim, double s_gain, vertex_t *tt, double *gmarg, double *mean, double *powm,
                  double *vari, double volu)
+{
+  /* do [unweighted] mean and vari */
+  smom(dim, tt, gmarg, mean, vari);
+  *powm = pow(*mean, s_gain);
+
+  /* scale mean and varience by volume. Plus powm */
+  *mean *= volu;
+  *vari *= volu * volu;
+  *powm *= volu;
+}
+
+/* simplex [unweighted] mean and variance */
+static void smom(int dim, vertex_t *tt, double *gmarg, double *mean, double *vari)
 {
   int j;
   double temp, sum, sqr;
 
-  /* do [unweighted] mean and vari */
   sum = sqr = 0.0;
   for (j = 0; dim > j; ++j) {
     temp = gmarg[tt[j]];
@@ -862,12 +1881,6 @@ static void sval(int dim, double s_gain, short *tt, double *gmarg, double *mean,
   *mean = sum / (double)dim;
   *vari = (sqr - sum * (*mean)) /
           (double)(dim - 1);  // sqr = N*average(x**2).  sum*(*mean) = N*(average(x))**2
-  *powm = pow(*mean, s_gain);
-
-  /* scale mean and varience by volume. Plus powm */
-  *mean *= volu;
-  *vari *= volu * volu;
-  *powm *= volu;
 }
 
 /* there is a slightly redundant implementation called det_dim in marg_opt_yield */
@@ -944,42 +1957,48 @@ static void ludcmp(double **a, int n, double *d, double *vv)
   } /* Go back for the next column in the reduction. */
 }
 
-static void vect_realloc(int *num, int inc, int dim, double **marg, double **gmarg, double ***p)
+/* The vectors p[i][0..dim] are rows of one block, `dim` doubles apart, so that the points of a
+ * simplex are near one another in memory. */
+static void vect_grow(int *num, int inc, int dim, double **marg, double **gmarg, double **vacc,
+                         double ***p)
 {
   int i;
 
   /* from 0 to num+inc */
   *marg = realloc(*marg, (*num + inc) * sizeof **marg);     // mem:scott
   *gmarg = realloc(*gmarg, (*num + inc) * sizeof **gmarg);  // mem:gabbroid
-  *p = realloc(*p, (*num + inc) * sizeof **p);              // mem:bachelor
-  /* from num to num+inc */
-  for (i = *num; (*num + inc) > i; ++i)
-    (*p)[i] = malloc(dim * sizeof ***p);  // mem:thwarting
+  *vacc = realloc(*vacc, (*num + inc) * sizeof **vacc);     // mem:tortfeasor
+  double *rows = *num ? (*p)[0] : NULL;
+  rows = realloc(rows, (*num + inc) * dim * sizeof *rows);  // mem:thwarting
+  *p = realloc(*p, (*num + inc) * sizeof **p);  // mem:bachelor
+  for (i = 0; (*num + inc) > i; ++i)
+    (*p)[i] = &rows[i * dim];
   *num += inc;
-  /* printf("More v!\n"); */
+  mem_bytes += inc * (long)(3 * sizeof **marg + dim * sizeof *rows + sizeof **p);
 }
 
-static void vect_free(int num, double *marg, double *gmarg, double **p)
+static void vect_free(int num, double *marg, double *gmarg, double *vacc, double **p)
 {
   free(marg);   // mem:scott
   free(gmarg);  // mem:gabbroid
-  for (int i = 0; num > i; ++i) {
-    free(p[i]);  // mem:thwarting
-  }
-  free(p);  // mem:bachelor
+  free(vacc);   // mem:tortfeasor
+  if (num)
+    free(p[0]);  // mem:thwarting
+  free(p);       // mem:bachelor
 }
 
-static void simp_realloc(int *numrow, int incrow, double ***p, short ***t, int dim)
+static void simp_grow(Arena *A, int *numrow, int incrow, double ***p, vertex_t ***t, int dim)
 {
   int i;
 
   /* from 0 to numrow+incrow */
   *p = realloc(*p, (*numrow + incrow) * sizeof **p);  // mem:cheese
   *t = realloc(*t, (*numrow + incrow) * sizeof **t);  // mem:antiloemic
+  mem_bytes += incrow * (long)(sizeof **p + sizeof **t);
   /* from numrow to numrow+incrow */
   for (i = *numrow; (*numrow + incrow) > i; ++i) {
-    (*p)[i] = malloc(PAGE_LINES * sizeof ***p);        // mem:reapparition
-    (*t)[i] = malloc(PAGE_LINES * dim * sizeof ***t);  // mem:reapparition
+    (*p)[i] = arena_alloc(A, PAGE_LINES * sizeof ***p);
+    (*t)[i] = arena_alloc(A, PAGE_LINES * dim * sizeof ***t);
   }
   *numrow += incrow;
   /* printf("More s!\n"); */
@@ -988,14 +2007,12 @@ static void simp_realloc(int *numrow, int incrow, double ***p, short ***t, int d
   /*     (long)(*numrow)*PAGE_LINES*((sizeof ***p)+dim*(sizeof ***t))/1024 ); */
 }
 
-static void simp_free(int numrow, double **p, short **t)
+/* Frees a simplex store (or the moment store, without `t`) of `numrow` pages from arena `A`. */
+static void simp_free(Arena *A, int numrow, double **p, vertex_t **t)
 {
-  int i;
-
-  for (i = 0; numrow > i; ++i) {
-    free(t[i]);  // mem:reapparition
-    free(p[i]);  // mem:reapparition
-  }
+  *(A->fd >= 0 ? &file_bytes : &mem_bytes) -= A->bytes;
+  mem_bytes -= numrow * (long)(sizeof *p + (t ? sizeof *t : 0));
+  arena_free(A);
   free(t);  // mem:antiloemic
   free(p);  // mem:cheese
 }
@@ -11,9 +11,7 @@
 #include <unistd.h>
 
 int define(Configuration *);
-int readData(Configuration *, Data *, int *scramble);
 void spiceBounds(Configuration *, Data *, int *scramble);
-void spicePlot(Configuration *);
 void dumpData(Data *);
 void bound(Data *, Configuration *);
 void dumpBounds(Configuration *, Data *, char *);
@@ -54,7 +52,7 @@ int define(Configuration *C)
     theData = malloc(sizeof *theData);  // mem:beslur
     /* do not change node definitions between simulate and envelope, or you are hosed */
     /* load vectors from spice print file */
-    if (!readData(C, theData, scramble))
+    if (!find_backend(C->options.backend)->read_nominal(C, theData, scramble))
       goto fail;
     /* make the envelope */
     bound(theData, C);
@@ -64,7 +62,8 @@ int define(Configuration *C)
     spiceBounds(C, theData, scramble);
   }
   /* now we want to call a spice script to view envelope */
-  spicePlot(C);
+  if (find_backend(C->options.backend)->plot)
+    find_backend(C->options.backend)->plot(C);
   ret = 1;
 fail:
   /* clean up generic temporary files */
@@ -17,5 +17,7 @@ typedef struct data {
 } Data;
 
 int call_def(Configuration *);
+int readData(Configuration *, Data *, int *scramble);
+void spicePlot(Configuration *);
 
 #endif
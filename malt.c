@@ -4,12 +4,15 @@
 #include "config.h"
 #include "corners.h"
 #include "define.h"
+#include "marg_opt_yield.h"
 #include "margins.h"
+#include "montecarlo.h"
 #include "optimize.h"
 #include <assert.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 void read_command_line(Args *args, int argc, char *argv[]);
@@ -58,6 +61,7 @@ int main(int argc, char *argv[])
   }
 
   /* call the appropriate algorithm */
+  budget_open(C);
   switch (args.function) {
   case 'd':
     if (!call_def(C))
@@ -87,8 +91,14 @@ int main(int argc, char *argv[])
     if (!call_opt(C))
       fprintf(stderr, "Optimize routine exited on an error\n");
     break;
+  case 'M':
+    if (!monte_carlo(C))
+      fprintf(stderr, "Monte Carlo routine exited on an error\n");
+    break;
   }
   free(args.configuration);  // mem:mobster
+  corners_unscreen();
+  budget_close();
   freeConfiguration(C);
 }
 
@@ -104,7 +114,7 @@ void read_command_line(Args *args, int argc, char *argv[])
   int c;
 
   /* find options and arguments */
-  while ((c = getopt(argc, argv, "hdmt2syovk")) != -1) {
+  while ((c = getopt(argc, argv, "hdmt2syovkM")) != -1) {
     /* have an option */
     switch (c) {
     case 'h':
@@ -117,6 +127,7 @@ void read_command_line(Args *args, int argc, char *argv[])
     case 's':
     case 'y':
     case 'o':
+    case 'M':
       if (have_function) {
         /* only one function is allowed per command line */
         usage();
@@ -190,6 +201,14 @@ void malt_status(FILE *log, const char *format, ...)
   fflush(log);
 }
 
+/* Returns the time in seconds on a monotonic clock, for timing things. */
+double wall_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
 /* Works like sprintf, but (re)allocates beforehand
  * Implementation adapted from:
  * https://stackoverflow.com/questions/4899221/substitute-or-workaround-for-asprintf-on-aix/4899487#4899487
@@ -16,6 +16,7 @@ void strchrcat(char *, int);
 char *resprintf(char **restrict strp, const char *fmt, ...);
 void lprintf(const Configuration *, const char *, ...);
 void malt_status(FILE *, const char *, ...);
+double wall_time(void);
 
 #define info(format, ...)                                       \
   {                                                             \
@@ -31,7 +32,7 @@ void malt_status(FILE *, const char *, ...);
     exit(EXIT_FAILURE);                                          \
   }
 
-#define MALTUSAGE "malt [-h] {-d|-m|-t|-2|-y|-o} [-k] CONFIG\n"
+#define MALTUSAGE "malt [-h] {-d|-m|-t|-2|-y|-o|-M} [-k] CONFIG\n"
 #define MALTVERSION "3.2"
 #define MALTHELP                                                                      \
   "Malt " MALTVERSION "\n"                                                            \
@@ -46,6 +47,7 @@ void malt_status(FILE *, const char *, ...);
   "  -2\tCalculate operating region in 2 dimensions\n"                                \
   "  -y\tCalculate circuit yield using corner analysis\n"                             \
   "  -o\tOptimize yield using inscribed hyperspheres\n"                               \
+  "  -M\tEstimate circuit yield by Monte Carlo sampling\n"                            \
   "\n"                                                                                \
   "OPTIONS\n"                                                                         \
   "  -k\tKeep (don't delete) additional temporary files\n"                            \
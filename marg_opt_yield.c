@@ -6,6 +6,7 @@
 #include "malt.h"
 #include "numerical.h"
 #include "space.h"
+#include "stat_math.h"
 #include <assert.h>
 #include <math.h>
 #include <pthread.h>
@@ -14,6 +15,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 void makeiter(Configuration *C, char func)
@@ -51,52 +53,89 @@ typedef struct addpoint_state {
   char *returnn;
   char *call;
   double *pc;
+  double *po;
+  double dist;     // width of the search bracket in units of the binsearch accuracy
+  double cost;     // predicted run time in seconds (or in simulations, before any were timed)
+  double started;  // wall time at which the wrspice process was started
   pid_t pid;
-  int ord;
+  corner_t ord;
+  int kept;    // the corner is one of those its search is screened down to
+  int search;  // index of the search (in the batch) that this job belongs to
+  int sims;    // number of simulations the binary search is expected to run, to schedule it
+  int dashc;   // the inner point is known to pass and is not simulated
 } addpoint_t;
 
-#define ADDPOINT_INIT                                             \
-  {                                                               \
-    .returnn = NULL, .call = NULL, .pc = NULL, .pid = 0, .ord = 0 \
+#define ADDPOINT_INIT                                                                         \
+  {                                                                                           \
+    .returnn = NULL, .call = NULL, .pc = NULL, .po = NULL, .dist = 0.0, .cost = 0.0,          \
+    .started = 0.0, .pid = 0, .ord = 0, .kept = 1, .search = 0, .sims = 0, .dashc = 0         \
   }
 
-/* Finds one point on the boundary of an operating area by binary search.
- *
- * Initializes `*state` and kicks off the wrspice process.
- *
- * Returns the PID of the wrspice process so kicked off, which is suitable for passing to waitpid.
+/* observed wall time per simulation, averaged over the finished jobs */
+static double sim_seconds = 0.0;
+/* simulations and jobs finished so far, and when the first job was started */
+static long sims_done = 0, jobs_done = 0;
+static int sims_most = 0;  // the most simulations any one job took
+static double first_started = 0.0;
+/* predicted and observed job times are logged here, so the cost model can be checked */
+static FILE *sched_log = NULL;
+
+/* Returns the number of simulations malt.binsearch runs for a bracket `dist` accuracies wide. */
+static int binsearch_sims(double dist, int dashc)
+{
+  int sims = dashc ? 0 : 1;  // dashc skips the inner point
+  if (dist == 0.0)
+    return sims;  // point-check
+  /* outer point, then halve delta=dist/2 until it is no larger than one accuracy */
+  for (++sims, dist /= 2.0; dist > 1.0; dist /= 2.0)
+    ++sims;
+  return sims;
+}
+
+/* Sets up one job of a boundary search by binary search: the corner values of `state->pc` and the
+ * outer point `state->po` of the bracket, together with its predicted cost.
  *
- * `ord` is the ordinal corresponding to the corner being calculated by this job. It is used for
- * uniquely identifying temporary files.
+ * `ord` is the ordinal corresponding to the corner being calculated by this job.
  */
-static pid_t start_addpoint(const Configuration *C, const Space *S, addpoint_t *state,
-                            const double *pc, const double *direction, int ord)
+static void prepare_addpoint(const Configuration *C, const Space *S, addpoint_t *state,
+                             const double *pc, const double *direction, corner_t ord)
 {
-#define PO_SHIFT C->options.binsearch_accuracy * 0.0001
-  double *po = malloc(N * sizeof *po);  // mem:hyperplastic
+#define PO_SHIFT C->accuracy * 0.0001
   /* need to know the starting point (pc[..]) and the search direction (direction[..]) */
+  state->po = malloc(N * sizeof *state->po);  // mem:hyperplastic
 
   /* assign values for this corner */
   state->pc = malloc((N + K) * sizeof *pc);
   memcpy(state->pc, pc, (N + K) * sizeof *pc);
   state->ord = ord;
   for (int i = N; i < N + K; ++i) {
-    state->pc[i] = (ord % 2) ? S[i].cornerhi : S[i].cornerlo;
-    ord /= 2;
+    state->pc[i] = ((ord >> (i - N)) & 1) ? S[i].cornerhi : S[i].cornerlo;
+  }
+
+  /* a point-check: po[0]=0 checks pc alone */
+  if (direction == NULL) {
+    memcpy(state->po, state->pc, N * sizeof *state->po);
+    state->dist = 0.0;
+    state->sims = binsearch_sims(state->dist, state->dashc);
+    state->cost = state->sims * (sim_seconds > 0.0 ? sim_seconds : 1.0);
+    return;
   }
 
   /* find the closest boundary and calculate the search points */
   double cbig = 0.0;
-  for (int i = 0; N > i; ++i) {
-    double bound = ((direction[i] > 0.0) ? C->params[i].min : C->params[i].max);
-    double c = direction[i] / (state->pc[i] - bound);
+  for (int i = 0; C->num_params_all > i; ++i) {
+    if (N <= i && !C->params[i].load)
+      continue;  // of the rest, only the followers of the principal components move
+    double d = malt_along(direction, C, i);
+    double bound = ((d > 0.0) ? C->params[i].min : C->params[i].max);
+    double c = d / (malt_at(state->pc, C, i) - bound);
     if (c > cbig)
       cbig = c;
   }
   /* po on the boundary */
   /* po shifted out a bit */
   for (int i = 0; N > i; ++i) {
-    po[i] = state->pc[i] - direction[i] / cbig - PO_SHIFT * direction[i];
+    state->po[i] = state->pc[i] - direction[i] / cbig - PO_SHIFT * direction[i];
   }
   /* calculate binsearch accuracy */
   /* in 1-D, dist=(state->pc[]-po[])/centerpnt[ ] */
@@ -104,35 +143,55 @@ static pid_t start_addpoint(const Configuration *C, const Space *S, addpoint_t *
   double dist2 = 0.0;
   for (int i = 0; N > i; ++i) {
     /* binsearch_accuracy is in units of sigma */
-    double dum = (state->pc[i] - po[i]);
+    double dum = (state->pc[i] - state->po[i]);
     dist2 += dum * dum;
   }
-  double dist = sqrt(dist2) / C->options.binsearch_accuracy;
+  state->dist = sqrt(dist2) / C->accuracy;
+  /* the bisection is serial, so its length fixes the run time */
+  state->sims = binsearch_sims(state->dist, state->dashc);
+  state->cost = state->sims * (sim_seconds > 0.0 ? sim_seconds : 1.0);
+#undef PO_SHIFT
+}
 
-  state->returnn =
-      resprintf(NULL, "%s.%c.%d.return", C->command, C->function, state->ord);  // mem:kamleika
-  state->call =
-      resprintf(NULL, "%s.%c.%d.call", C->command, C->function, state->ord);  // mem:workmanships
+/* Finds one point on the boundary of an operating area by binary search.
+ *
+ * Kicks off the wrspice process for a job set up by `prepare_addpoint`.
+ *
+ * Returns the PID of the wrspice process so kicked off, which is suitable for passing to waitpid.
+ *
+ * `id` uniquely identifies the job within its batch. It is used for naming temporary files.
+ */
+static pid_t start_addpoint(const Configuration *C, addpoint_t *state, int id)
+{
+  state->returnn = resprintf(NULL, "%s.%c.%d.return", C->command, C->function, id);  // mem:kamleika
+  state->call = resprintf(NULL, "%s.%c.%d.call", C->command, C->function, id);  // mem:workmanships
   /* write .call file, call spice */
-  state->pid = start_spice(C, dist, state->pc, po, state->call, state->returnn);
-  free(po);  // mem:hyperplastic
+  state->started = wall_time();
+  if (first_started == 0.0)
+    first_started = state->started;
+  state->pid =
+      start_spice(C, state->dist, state->pc, state->po, state->dashc, state->call, state->returnn);
+  free(state->po);  // mem:hyperplastic
+  state->po = NULL;
   return state->pid;
-#undef PO_SHIFT
 }
 
 /* Cleans up after wrspice and collects the data, storing the resulting point in pr_temp[0..N], or
- * returning 0 (without modifying pr_temp[..]) if concavity is detected.
+ * returning 0 (without modifying pr_temp[..]) if concavity is detected. A point-check stores no
+ * point, and returns 0 if the point failed.
  *
  * This function must not be called until after the wrspice process is finished, lest it read
  * incomplete data.
  *
  * `pr_temp` is the destination where the boundary point will be stored.
  *
- * On success, the value of `ord` originally passed to `start_addpoint` will be stored in `*ord`.
+ * On success, the value of `ord` originally passed to `prepare_addpoint` will be stored in `*ord`.
  */
-static int addpoint_done(const Configuration *C, double *pr_temp, int *ord, addpoint_t *state)
+static int addpoint_done(const Configuration *C, double *pr_temp, corner_t *ord,
+                         addpoint_t *state)
 {
   FILE *fp;
+  double observed = wall_time() - state->started;
 
   /* read .return file */
   if ((fp = fopen(state->returnn, "r")) == NULL) {
@@ -145,10 +204,13 @@ static int addpoint_done(const Configuration *C, double *pr_temp, int *ord, addp
   int r = fscanf(fp, "%d", &concave);
   assert(1 == r);
 
-  if (!concave) {
-    /* throw away the zeroeth array element */
-    int r = fscanf(fp, "%*f");
-    assert(0 == r);
+  int sims = state->dashc ? 0 : 1;  // the inner point
+  if (!concave && state->dist != 0.0) {
+    /* the zeroeth array element counts down the bisection, from dist if the outer point passed */
+    double count;
+    int r = fscanf(fp, "%lf", &count);
+    assert(1 == r);
+    sims = (fabs(count - state->dist) <= 1e-4 * state->dist) ? sims + 1 : state->sims;
     for (int i = 0; N > i; ++i) {
       double pr_i;
       int r = fscanf(fp, "%lf", &pr_i);
@@ -160,6 +222,23 @@ static int addpoint_done(const Configuration *C, double *pr_temp, int *ord, addp
   // set *ord for caller
   *ord = state->ord;
 
+  /* count the simulations run, and check the cost model */
+  if (sched_log != NULL && sim_seconds > 0.0) {
+    double predicted = state->sims * sim_seconds;
+    fprintf(sched_log, "%6d %6llu %4d %4d %10.3f %10.3f %+7.1f\n", state->search,
+            (unsigned long long)state->ord, state->sims, sims, predicted, observed,
+            100.0 * (observed - predicted) / predicted);
+  }
+  sims_done += sims;
+  ++jobs_done;
+  if (sims_most < sims)
+    sims_most = sims;
+  if (sims > 0) {
+    /* running average over the recent jobs */
+    double per_sim = observed / sims;
+    sim_seconds = (sim_seconds > 0.0) ? 0.9 * sim_seconds + 0.1 * per_sim : per_sim;
+  }
+
   // clean up
   fclose(fp);
   unlink(state->call);
@@ -175,171 +254,602 @@ static int addpoint_done(const Configuration *C, double *pr_temp, int *ord, addp
   return (!concave);
 }
 
-/* Checks if `addpoint_done` has been called on a job yet or not. */
-static bool addpoint_is_done(const addpoint_t *state) { return state->pid == 0; }
+/* Orders jobs longest-expected-first, then by search and corner. */
+static int by_cost(const void *a, const void *b)
+{
+  const addpoint_t *x = *(addpoint_t *const *)a, *y = *(addpoint_t *const *)b;
+  if (x->cost != y->cost)
+    return (x->cost < y->cost) ? 1 : -1;
+  if (x->search != y->search)
+    return x->search - y->search;
+  return (x->ord > y->ord) - (x->ord < y->ord);
+}
 
-/* Finds one point on the boundary of an operating area at the most limiting corner.
- *
- * This function takes the intersection of all the corners to find the smallest point in (N)d space
- * that works for all corners.
- *
- * `pc` is the center of the operating area given as a point in (N+K)d space, where N is
- * C->num_params and K is C->num_params_corn.
- *
- * `direction` is a unit vector in (N)d space representing the opposite direction along which to
- * search. (When `direction[i]` is positive the search along the (i)th axis will be in the negative
- * direction, and vice versa.)
+/* Finds the boundary points of a batch of searches, at the most limiting of the corners
+ * `corners[first[s]..first[s + 1]]` of each search s.
  *
- * If `cornmin` is not NULL, `*cornmin` will be set to the ordinal value of the limiting corner.
+ * All the (search, corner) jobs of the batch share the simulator slots. Queued jobs are started
+ * longest-expected-first, so that a long bisection is not the last thing left running while the
+ * other slots sit idle. Once every corner of a search is finished, `done` is called with it
+ * (unless `done` is NULL).
  *
- * If `pr` is not NULL, the boundary point at the most limiting corner will be stored in `pr[0..N]`.
+ * Only the first `screened[s]` corners of search s are those it is screened down to; if
+ * `kept_margin` is not NULL, the least margin at them is stored in `kept_margin[s]`.
  *
- * Returns the distance from the origin in units of sigma.
+ * Returns 1 if every search found a boundary, 0 if the center of any search failed.
  */
-double addpoint_corners(const Configuration *C, const Space *S, corner_t *cornmin, double *pr,
-                        const double *pc, const double *direction)
+static int run_batch(const Configuration *C, const Space *S, Search *searches, int num,
+                     const corner_t *corners, const int *first, const int *screened,
+                     double *kept_margin, void (*done)(Search *, void *), void *ctx)
 {
 /* maximum number of subprocesses to run concurrently */
 #define MAX_SUBS (C->options.max_subprocesses)
-  int num_corn = 1 << K;
+  int num_jobs = first[num];
+  int all_good = 1;
 
   /* set the corners=1 parameters to the corner values each in turn & calc margins */
   /* if there are none such then calc margins just once */
-  /* *** later, the configuration can decide which corners to include if you specify *** */
+  addpoint_t *jobs = malloc(num_jobs * sizeof *jobs);    // mem:rebatch
+  addpoint_t **queue = malloc(num_jobs * sizeof *queue);  // mem:queachy
+  if (sched_log == NULL && C->file_names.sched != NULL &&
+      (sched_log = fopen(C->file_names.sched, "w")) != NULL)
+    fprintf(sched_log, "# search corner sims ran predicted[s] observed[s] error[%%]\n");
+  for (int s = 0; s < num; ++s) {
+    searches[s].margin = INFINITY;  // guaranteed to be greater than f at least once
+    searches[s].cornmin = 0;
+    searches[s].pending = first[s + 1] - first[s];
+    if (kept_margin != NULL)
+      kept_margin[s] = INFINITY;
+    for (int c = first[s]; c < first[s + 1]; ++c) {
+      addpoint_t init = ADDPOINT_INIT, *job = &jobs[c];
+      *job = init;
+      job->search = s;
+      job->kept = c - first[s] < screened[s];
+      /* a point-check has nothing but its point to simulate */
+      job->dashc = searches[s].direction != NULL &&
+                   (searches[s].skip_center || (C->function == 'y' && C->func_init == 0));
+      prepare_addpoint(C, S, job, searches[s].pc, searches[s].direction, corners[c]);
+      queue[c] = job;
+    }
+  }
+  qsort(queue, num_jobs, sizeof *queue, by_cost);
 
-  // spawn up to as many processes as there are corners, but not more than MAX_SUBS
+  // spawn up to as many processes as there are jobs, but not more than MAX_SUBS
   // (unless MAX_SUBS is zero, in which case spawn as many as you want)
-  int processes = (MAX_SUBS > 0 && num_corn > MAX_SUBS) ? MAX_SUBS : num_corn;
-  addpoint_t *jobs = malloc(processes * sizeof *jobs);
-  int job;  // number of jobs started so far
-  for (job = 0; job < processes; ++job) {
-    addpoint_t init = ADDPOINT_INIT;
-    jobs[job] = init;
-    pid_t w = start_addpoint(C, S, &jobs[job], pc, direction, job);
-    assert(w > 0);
-  }
-
-  // clean up the processes as they finish (and replace them with new ones)
-  double f_min = INFINITY;                        // guaranteed to be greater than f at least once
+  int processes = (MAX_SUBS > 0 && num_jobs > MAX_SUBS) ? MAX_SUBS : num_jobs;
+  int running = 0, next = 0;  // jobs running, and the next job in the queue
   double *pr_temp = malloc(N * sizeof *pr_temp);  // mem:astern
-  while (job < num_corn) {
-    // wait for any wrspice process to finish
-    int status;
-    pid_t w;
-    do {
-      w = waitpid(-1, &status, 0);
-      if (-1 == w) {
-        perror("malt: waitpid");
+  for (;;) {
+    // fill the free slots from the queue
+    while (running < processes && next < num_jobs) {
+      addpoint_t *job = queue[next++];
+      Search *search = &searches[job->search];
+      if (search->margin == 0.0 &&
+          !(job->kept && kept_margin != NULL && kept_margin[job->search] != 0.0)) {
+        // the search has already failed: skip the rest of its corners (but for an audit, those
+        // screened until one of them fails too)
+        free(job->pc);
+        free(job->po);  // mem:hyperplastic
+        job->pc = job->po = NULL;
+        if (--search->pending == 0 && done != NULL)
+          done(search, ctx);
+        continue;
+      }
+      if (running > 0 && !spice_slot_reserve(C, 0)) {
+        // the host is busy: put the job back until one of ours finishes
+        --next;
+        break;
+      }
+      if (start_addpoint(C, job, (int)(job - jobs)) <= 0) {
+        fprintf(stderr, "malt: Cannot start the simulator\n");
         exit(EXIT_FAILURE);
       }
-    } while (!WIFEXITED(status));
-
-    int err = WEXITSTATUS(status);
-    if (err != 0) {
-      fprintf(stderr, "malt: %s returned an error (%d)\n", C->options.spice_call_name, err);
-      perror("malt");
+      ++running;
     }
+    if (running == 0)
+      break;
+
+    // wait for any wrspice process to finish
+    pid_t w = wait_spice(C, -1);
 
     // find the job that exited by looking up its PID
     int j;
-    for (j = 0; j < processes; ++j) {
+    for (j = 0; j < num_jobs; ++j) {
       if (jobs[j].pid == w) {
         break;
       }
     }
-    assert(j < processes);
+    assert(j < num_jobs);
+    --running;
 
     // finalize the job and check if the margin is 0
-    int ord;  // ordinal of the just-finished job
+    Search *search = &searches[jobs[j].search];
+    corner_t ord;  // ordinal of the just-finished job
     if (0 == addpoint_done(C, pr_temp, &ord, &jobs[j])) {
-      /* this error message must not be here cause it jacks up the optimize routine */
-      /* fprintf(stderr, "Circuit failed at nominal (%s:%d)\n", __FILE__, __LINE__); */
-      // set result to 0.0
-      f_min = 0.0;
-      break;
+      /* no error message here cause it jacks up the optimize routine */
+      // set result to 0.0, keeping the first corner that failed
+      if (search->margin != 0.0)
+        search->cornmin = ord;
+      search->margin = 0.0;
+      if (kept_margin != NULL && jobs[j].kept)
+        kept_margin[jobs[j].search] = 0.0;
+      all_good = 0;
+    } else if (search->direction != NULL && search->margin != 0.0) {
+      /* f is the size of the margin for this corner */
+      double f2 = 0.0;
+      for (int i = 0; i < N; ++i) {
+        f2 += pow((search->pc[i] - pr_temp[i]), 2.0);
+      }
+      double f = sqrt(f2);
+
+      /* pick the first corner (margin starts at +infinity) or least corner */
+      if (search->margin > f || (search->margin == f && ord < search->cornmin)) {
+        search->margin = f;
+        if (search->pr != NULL) {
+          for (int i = 0; i < N; ++i)
+            search->pr[i] = pr_temp[i]; /* copy temporary result to final result */
+        }
+        search->cornmin = ord;
+      }
+      if (kept_margin != NULL && jobs[j].kept && kept_margin[jobs[j].search] > f)
+        kept_margin[jobs[j].search] = f;
     }
+    if (--search->pending == 0 && done != NULL)
+      done(search, ctx);
+  }
+  if (sched_log != NULL)
+    fflush(sched_log);
+  free(pr_temp);  // mem:astern
+  free(queue);    // mem:queachy
+  free(jobs);     // mem:rebatch
+  return all_good;
+#undef MAX_SUBS
+}
 
-    // start a new job, reusing this job's slot
-    w = start_addpoint(C, S, &jobs[j], pc, direction, job++);
-    assert(w > 0);
+/* most corner parameters for which the audits take a search at all 2^K corners */
+#define AUDIT_MAX_K 16
+
+/* The corners screened by probe_corners(). Instead of at all 2^K corners, each search is taken at
+ * the worst corner of the probe along each axis it heads down or up, at the corner the effects of
+ * those probes add up to be worst along its own direction and at those one flip away from it, and
+ * at the corners the audits have caught. A point-check is taken at the corners of a search out from
+ * the nominal to its point. */
+static struct {
+  int state;          // 0 not probed yet, 1 screened, -1 every search is taken at all corners
+  int num_probes;     // 2N: the probes down (even) and up (odd) each axis
+  corner_t *worst;    // the worst corner of each probe
+  double *margin;     // the margin of each probe with every corner parameter low
+  double *effect;     // effect[p * K + j]: change of the margin of probe p with corner j high alone
+  corner_t *kept;     // the corners the audits found more limiting than those screened
+  int num_kept;
+  int most;           // the most corners any search is taken at
+  long num_searches;  // searches taken since the probes, to pick those that are audited
+  long audits, misses;
+} screening = {.state = 0};
+
+/* Adds corner `c` to the set `set[0..*num]`, unless it is there already. */
+static void corner_add(corner_t *set, int *num, corner_t c)
+{
+  for (int k = 0; *num > k; ++k)
+    if (set[k] == c)
+      return;
+  set[(*num)++] = c;
+}
 
-    /* f is the size of the margin for this corner */
-    double f2 = 0.0;
-    for (int i = 0; i < N; ++i) {
-      f2 += pow((pc[i] - pr_temp[i]), 2.0);
+/* Returns the most corners corner_set() can store. */
+static int corner_set_most(const Configuration *C)
+{
+  return 1 + K + screening.num_probes + screening.num_kept;
+}
+
+/* Stores in `set[..]` the corners a search along `direction` is screened down to, and returns how
+ * many.
+ *
+ * The effects the probes measured are added up along `direction`, each axis weighed as the normal
+ * of the ellipsoid through the margins of the probes would be: where the boundary is near, a
+ * shift along that axis moves it most. */
+static int corner_set(const Configuration *C, const double *direction, corner_t *set)
+{
+  int num = 0;
+  corner_t worst = 0;
+  for (int j = 0; K > j; ++j) {
+    double effect = 0.0;
+    for (int i = 0; screening.num_probes / 2 > i; ++i) {
+      int p = 2 * i + (direction[i] < 0.0);
+      effect += fabs(direction[i]) / (screening.margin[p] * screening.margin[p]) *
+                screening.effect[p * K + j];
     }
-    double f = sqrt(f2);
-
-    /* pick the first corner (f_min starts at +infinity) or least corner */
-    if (f_min > f) {
-      f_min = f;
-      if (pr != NULL) {
-        for (int i = 0; i < N; ++i)
-          pr[i] = pr_temp[i]; /* copy temporary result to final result */
+    if (effect < 0.0)
+      worst |= (corner_t)1 << j;
+  }
+  set[num++] = worst;
+  for (int j = 0; K > j; ++j)
+    set[num++] = worst ^ (corner_t)1 << j;  // in case the effects do not add up
+  for (int p = 0; screening.num_probes > p; ++p) {
+    int i = p / 2;
+    if (direction[i] != 0.0 && (direction[i] < 0.0) == (p % 2))
+      corner_add(set, &num, screening.worst[p]);
+  }
+  for (int k = 0; screening.num_kept > k; ++k)
+    corner_add(set, &num, screening.kept[k]);
+  return num;
+}
+
+/* Prints corner `c` as one L or H per corner parameter. */
+static void corner_print(const Configuration *C, corner_t c)
+{
+  for (int j = 0; K > j; ++j)
+    lprintf(C, "%s", (c >> j) & 1 ? "H" : "L");
+}
+
+/* Probes the effect of each corner parameter on the 1D margins from the nominal center: down and
+ * up each axis, at the corner with every corner parameter low and at those with one of them high.
+ * Those that shrink the margin by more than the binsearch accuracy are set high, and the probes are
+ * taken again about that corner, flipping each corner parameter in turn: the flip that shrinks the
+ * margin the most is kept, in case some of them interact. This is the worst corner of the probe.
+ * While the effects are monotonic, every other corner is dominated by it along that axis.
+ *
+ * Returns 0 if the center failed at any probed corner, and then every search is taken at all
+ * corners. */
+static int probe_corners(const Configuration *C, const Space *S)
+{
+  int ret = 0;
+  int num = 2 * N * (K + 1);
+  double *pc = malloc((N + K) * sizeof *pc);                 // mem:prober
+  double *direction = calloc(2 * N * N, sizeof *direction);  // mem:upcoil
+  Search *probes = malloc(num * sizeof *probes);             // mem:overgild
+  corner_t *corners = malloc(num * sizeof *corners);         // mem:tinsmith
+  int *first = malloc((num + 1) * sizeof *first);            // mem:whinstone
+  int *screened = malloc(num * sizeof *screened);            // mem:hornbill
+
+  screening.state = -1;
+  screening.worst = calloc(2 * N, sizeof *screening.worst);          // mem:leewardly
+  screening.effect = malloc(2 * N * K * sizeof *screening.effect);  // mem:cowhage
+  screening.margin = malloc(2 * N * sizeof *screening.margin);       // mem:alembic
+  double *effect = screening.effect;
+  for (int i = 0; N + K > i; ++i)
+    pc[i] = S[i].centerpnt;
+  for (int p = 0; 2 * N > p; ++p)
+    direction[p * N + p / 2] = (p % 2) ? -1.0 : 1.0;  // as in margins_and, up is -1 and down is 1
+  lprintf(C, "\nProbing %d corner parameters down and up %d axes\n", K, N);
+  for (int round = 0; 2 > round; ++round) {
+    for (int p = 0; 2 * N > p; ++p) {
+      for (int j = 0; K >= j; ++j) {
+        int s = p * (K + 1) + j;
+        probes[s] = SEARCH_INIT(pc, &direction[p * N], NULL);
+        corners[s] = screening.worst[p] ^ (j ? (corner_t)1 << (j - 1) : 0);
+        first[s] = s;
+        screened[s] = 1;
       }
-      if (cornmin != NULL) {
-        *cornmin = ord;
+    }
+    first[num] = num;
+    if (!run_batch(C, S, probes, num, corners, first, screened, NULL, NULL, NULL)) {
+      lprintf(C, "The center failed at a probed corner: every search is taken at all corners\n");
+      goto fail;
+    }
+    for (int p = 0; 2 * N > p; ++p) {
+      const Search *probe = &probes[p * (K + 1)];
+      corner_t flips = 0;
+      double most = -C->accuracy;
+      if (round == 0)
+        screening.margin[p] = probe->margin;
+      for (int j = 0; K > j; ++j) {
+        double change = probe[j + 1].margin - probe->margin;
+        if (round == 0) {
+          effect[p * K + j] = change;
+          if (change < most)
+            flips |= (corner_t)1 << j;
+        } else if (change < most) {
+          most = change;
+          flips = (corner_t)1 << j;
+        }
       }
+      screening.worst[p] ^= flips;
     }
   }
+  screening.num_probes = 2 * N;
+
+  lprintf(C, "Probe                   Margin ");
+  for (int j = 0; K > j; ++j)
+    lprintf(C, " %7.7s", C->params[N + j].name);
+  lprintf(C, "  Worst\n");
+  for (int p = 0; 2 * N > p; ++p) {
+    lprintf(C, "%3d) %-14.14s %4s %7.2f ", p / 2 + 1, C->params[p / 2].name,
+            (p % 2) ? "High" : "Low", screening.margin[p]);
+    for (int j = 0; K > j; ++j)
+      lprintf(C, " %+7.2f", effect[p * K + j]);
+    lprintf(C, "  ");
+    corner_print(C, screening.worst[p]);
+    lprintf(C, "\n");
+  }
+  screening.most = corner_set_most(C);
+  screening.state = 1;
+  lprintf(C, "Each search is taken at %d of the %llu corners at most", screening.most,
+          (unsigned long long)((corner_t)1 << K));
+  if (C->options.c_audit > 0 && K <= AUDIT_MAX_K)
+    lprintf(C, ", and every %d at all of them\n", C->options.c_audit);
+  else
+    lprintf(C, "\n");
+  ret = 1;
+fail:
+  free(screened);   // mem:hornbill
+  free(first);      // mem:whinstone
+  free(corners);    // mem:tinsmith
+  free(probes);     // mem:overgild
+  free(direction);  // mem:upcoil
+  free(pc);         // mem:prober
+  return ret;
+}
 
-  // wait for the remaining jobs to finish
-  for (int j = 0; j < processes; ++j) {
-    // if the process has already finished: skip it
-    if (addpoint_is_done(&jobs[j])) {
-      continue;
-    }
+/* Forgets the probes of included normal parameter `i`, which no longer varies. */
+static void corners_freeze(const Configuration *C, int i)
+{
+  if (screening.state != 1)
+    return;
+  memmove(&screening.worst[2 * i], &screening.worst[2 * i + 2],
+          (screening.num_probes - 2 * i - 2) * sizeof *screening.worst);
+  memmove(&screening.margin[2 * i], &screening.margin[2 * i + 2],
+          (screening.num_probes - 2 * i - 2) * sizeof *screening.margin);
+  memmove(&screening.effect[2 * i * K], &screening.effect[(2 * i + 2) * K],
+          (screening.num_probes - 2 * i - 2) * K * sizeof *screening.effect);
+  screening.num_probes -= 2;
+  screening.most = corner_set_most(C);
+}
 
-    // else: wait for THIS wrspice process to finish
-    int status;
-    do {
-      if (-1 == waitpid(jobs[j].pid, &status, 0)) {
-        perror("malt: waitpid");
-        exit(EXIT_FAILURE);
-      }
-    } while (!WIFEXITED(status));
+/* Probes the corner parameters the first time, if [corners] screen is set. Stops if the probes
+ * fail with too many corner parameters to take every search at all corners instead. */
+void corners_probe(const Configuration *C, const Space *S)
+{
+  if (screening.state == 0)
+    if (!C->options.c_screen || K < 2 || !probe_corners(C, S))
+      screening.state = -1;
+  if (screening.state == -1 && K > CORNERS_ALL_MAX)
+    error("The probes of the corner parameters failed, and the %d of them are too many to take "
+          "every search at all corners\n",
+          K);
+}
 
-    int err = WEXITSTATUS(status);
-    if (err != 0) {
-      fprintf(stderr, "malt: %s returned an error (%d)\n", C->options.spice_call_name, err);
-      perror("malt");
-    }
+/* Returns how many corners a search is taken at, at most. */
+int corners_per_search(const Configuration *C)
+{
+  if (screening.state == 1)
+    return screening.most;
+  if (screening.state == 0 && C->options.c_screen && K > 1)
+    return K + 1;  // as the probes take each axis, at least
+  assert(K <= CORNERS_ALL_MAX);  // corners_probe() stops otherwise
+  return 1 << K;
+}
 
-    // finalize the job and check if the margin is 0
-    int ord;  // ordinal of the just-finished job
-    if (0 == addpoint_done(C, pr_temp, &ord, &jobs[j])) {
-      // set result to 0.0
-      // don't print this error for optimize, cause it is only just a convexity thing
-      if (C->function != 'o')
-        fprintf(stderr, "Circuit failed at nominal (%s:%d)\n", __FILE__, __LINE__);
-      f_min = 0.0;
-      // but keep waiting for the rest of the jobs
+/* Frees what the screening of the corners keeps. */
+void corners_unscreen(void)
+{
+  free(screening.worst);  // mem:leewardly
+  screening.worst = NULL;
+  free(screening.margin);  // mem:alembic
+  screening.margin = NULL;
+  free(screening.effect);  // mem:cowhage
+  screening.effect = NULL;
+  free(screening.kept);  // mem:chiliad
+  screening.kept = NULL;
+  screening.num_kept = screening.num_probes = 0;
+}
+
+/* Finds the boundary points of a batch of searches, at the most limiting corner of each.
+ *
+ * Every search is taken at all 2^K corners, unless [corners] screen is set. Then the corner
+ * parameters are probed the first time, and each search is taken at the worst corners only. Every
+ * c_audit-th search or point-check is still taken at all corners: should one of the others limit
+ * the search by more than the binsearch accuracy, or fail the point-check where the worst ones
+ * pass, that corner is taken along with the worst ones from then on.
+ *
+ * Once every corner of a search is finished, `done` is called with it (unless `done` is NULL).
+ *
+ * Returns 1 if every search found a boundary, 0 if the center of any search failed.
+ */
+int addpoint_batch(const Configuration *C, const Space *S, Search *searches, int num,
+                   void (*done)(Search *, void *), void *ctx)
+{
+  corners_probe(C, S);
+  int num_corn = corners_per_search(C), num_audits = 0;
+  int *first = malloc((num + 1) * sizeof *first);           // mem:gimbaled
+  int *screened = malloc(num * sizeof *screened);           // mem:sunstroke
+  double *kept_margin = malloc(num * sizeof *kept_margin);  // mem:lodesman
+  char *audited = calloc(num, sizeof *audited);             // mem:prewarms
+  double *toward = malloc(N * sizeof *toward);              // mem:pintado
+  if (screening.state == 1 && C->options.c_audit > 0 && K <= AUDIT_MAX_K) {
+    for (int s = 0; s < num; ++s) {
+      if (++screening.num_searches % C->options.c_audit == 0) {
+        audited[s] = 1;
+        ++num_audits;
+      }
+    }
+  }
+  size_t num_jobs = (size_t)num * num_corn + ((size_t)num_audits << K);
+  corner_t *corners = malloc(num_jobs * sizeof *corners);  // mem:stemson
+  int c = 0;
+  for (int s = 0; s < num; ++s) {
+    first[s] = c;
+    if (screening.state != 1) {
+      for (corner_t ord = 0; ord < (corner_t)num_corn; ++ord)
+        corners[c++] = ord;
+      screened[s] = num_corn;
       continue;
     }
-
-    /* f is the size of the margin for this corner */
-    double f2 = 0.0;
-    for (int i = 0; i < N; ++i) {
-      f2 += pow((pc[i] - pr_temp[i]), 2.0);
+    const double *direction = searches[s].direction;
+    if (direction == NULL) {
+      /* a point-check heads out to its point, as a search from the nominal would */
+      for (int i = 0; N > i; ++i)
+        toward[i] = S[i].centerpnt - searches[s].pc[i];
+      direction = toward;
     }
-    double f = sqrt(f2);
-
-    /* pick the first corner (f_min starts at +infinity) or least corner */
-    if (f_min > f) {
-      f_min = f;
-      if (pr != NULL) {
-        for (int i = 0; i < N; ++i)
-          pr[i] = pr_temp[i]; /* copy temporary result to final result */
-      }
-      if (cornmin != NULL) {
-        *cornmin = ord;
+    int n = corner_set(C, direction, &corners[c]);
+    screened[s] = n;
+    if (audited[s]) {
+      /* the rest of the corners follow those screened */
+      for (corner_t ord = 0; ord < (corner_t)1 << K; ++ord) {
+        int k = 0;
+        while (k < screened[s] && corners[c + k] != ord)
+          ++k;
+        if (k == screened[s])
+          corners[c + n++] = ord;
       }
     }
+    c += n;
   }
-  free(pr_temp);  // mem:astern
+  first[num] = c;
+
+  int all_good = run_batch(C, S, searches, num, corners, first, screened, kept_margin, done, ctx);
+
+  for (int s = 0; s < num; ++s) {
+    int point_check = searches[s].direction == NULL;
+    if (!audited[s] || (!point_check && searches[s].margin == 0.0))
+      continue;
+    ++screening.audits;
+    if (point_check ? !(searches[s].margin == 0.0 && kept_margin[s] != 0.0)
+                    : kept_margin[s] - searches[s].margin <= C->accuracy)
+      continue;
+    ++screening.misses;
+    screening.kept = realloc(screening.kept,
+                             (screening.num_kept + 1) * sizeof *screening.kept);  // mem:chiliad
+    screening.kept[screening.num_kept++] = searches[s].cornmin;
+    screening.most = corner_set_most(C);
+    lprintf(C, "\nCorner audit: ");
+    corner_print(C, searches[s].cornmin);
+    if (point_check)
+      lprintf(C, " fails a point-check that passes at the worst corners, and is taken from now "
+                 "on\n");
+    else
+      lprintf(C, " limits a search %.2f sigma more than the worst corners, and is taken from now "
+                 "on\n",
+              kept_margin[s] - searches[s].margin);
+  }
+  free(toward);       // mem:pintado
+  free(corners);      // mem:stemson
+  free(audited);      // mem:prewarms
+  free(kept_margin);  // mem:lodesman
+  free(screened);     // mem:sunstroke
+  free(first);        // mem:gimbaled
+  return all_good;
+}
 
+/* Returns 1 if a batch of `searches` more boundary searches is expected to fit in what is left of
+ * the max_simulations and deadline budgets, or 0 if it is not (saying why when `why`).
+ *
+ * The simulation count is bounded by the longest job seen so far, so that max_simulations is not
+ * overrun; the time is predicted from the average job. */
+static int budget_check(const Configuration *C, int searches, int why)
+{
+  int jobs = searches * corners_per_search(C);
+  double per_job = jobs_done ? (double)sims_done / jobs_done : 0.0;
+
+  if (C->options.max_simulations > 0 &&
+      sims_done + (long)jobs * sims_most > C->options.max_simulations) {
+    if (why)
+      lprintf(C, "\nThe next %d searches would exceed max_simulations = %d\n", searches,
+              C->options.max_simulations);
+    return 0;
+  }
+  if (C->options.deadline > 0.0) {
+    int slots = (C->options.max_subprocesses > 0 && jobs > C->options.max_subprocesses)
+                    ? C->options.max_subprocesses
+                    : jobs;
+    double seconds = ceil((double)jobs / slots) * per_job * sim_seconds;
+    double left = C->options.deadline - time(NULL);
+    if (seconds > left) {
+      if (why)
+        lprintf(C,
+                "\nThe next %d searches would run past the deadline (%.0f s needed, %.0f s "
+                "left)\n",
+                searches, seconds, left);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Returns 1 if a batch of `searches` more boundary searches is expected to fit in the budget, or 0
+ * if it is not (saying why, the first time). */
+int budget_allows(const Configuration *C, int searches)
+{
+  static int told = 0;
+
+  if (budget_check(C, searches, 0))
+    return 1;
+  if (!told++)
+    budget_check(C, searches, 1);
+  return 0;
+}
+
+/* Returns how many of `searches` more boundary searches, at most, are expected to fit in the
+ * budget as one batch. Says nothing: budget_allows does that once the answer is none. */
+int budget_fits(const Configuration *C, int searches)
+{
+  while (searches > 0 && !budget_check(C, searches, 0))
+    --searches;
+  return searches;
+}
+
+/* Names the log of the cost model, <command>.sched.<function>. The first batch of searches opens
+ * it. */
+void budget_open(Configuration *C)
+{
+  resprintf(&C->file_names.sched, "%s.sched.%c", C->command, C->function);  // mem:tolbooth
+}
+
+/* Closes the log of the cost model. */
+void budget_close(void)
+{
+  if (sched_log != NULL)
+    fclose(sched_log);
+  sched_log = NULL;
+}
+
+/* Prints how many simulations have been run and in how much wall time, and how the screened
+ * corners fared in their audits. */
+void budget_report(const Configuration *C)
+{
+  if (screening.audits)
+    lprintf(C, "Corner audits: %ld, of which %ld caught a corner the probes missed\n",
+            screening.audits, screening.misses);
+  lprintf(C, "Simulations: %ld in %.0f s\n", sims_done,
+          first_started > 0.0 ? wall_time() - first_started : 0.0);
+}
+
+/* Returns how many simulations have been run so far. */
+long budget_sims(void)
+{
+  return sims_done;
+}
+
+/* Finds one point on the boundary of an operating area at the most limiting corner.
+ *
+ * This function takes the intersection of all the corners to find the smallest point in (N)d space
+ * that works for all corners.
+ *
+ * `pc` is the center of the operating area given as a point in (N+K)d space, where N is
+ * C->num_params and K is C->num_params_corn.
+ *
+ * `direction` is a unit vector in (N)d space representing the opposite direction along which to
+ * search. (When `direction[i]` is positive the search along the (i)th axis will be in the negative
+ * direction, and vice versa.)
+ *
+ * If `cornmin` is not NULL, `*cornmin` will be set to the ordinal value of the limiting corner.
+ *
+ * If `pr` is not NULL, the boundary point at the most limiting corner will be stored in `pr[0..N]`.
+ *
+ * Returns the distance from the origin in units of sigma.
+ */
+double addpoint_corners(const Configuration *C, const Space *S, corner_t *cornmin, double *pr,
+                        const double *pc, const double *direction)
+{
+  Search search = SEARCH_INIT(pc, direction, pr);
+
+  addpoint_batch(C, S, &search, 1, NULL, NULL);
+  if (cornmin != NULL) {
+    *cornmin = search.cornmin;
+  }
   /* return the distance from the origin in units of sigma, for whoever wants it */
-  return f_min;
+  return search.margin;
 }
 
 enum Direction {
@@ -350,13 +860,23 @@ enum Direction {
 /* Calculates the intersection of 1-D margins at all corners, storing the high margins in
  * `prhi[..]` and low margins in `prlo[..]` */
 int margins(Configuration *C, const Space *S, double *prhi, double *prlo)
+{
+  return margins_and(C, S, prhi, prlo, NULL, 0);
+}
+
+/* As margins, but the `num_more` searches `more[..]` are run in the same batch as the 1-D margins,
+ * so that the slots stay busy from the first search to the last. Their results are left in
+ * `more[..]`, and the margins are printed in order once the whole batch is finished. */
+int margins_and(Configuration *C, const Space *S, double *prhi, double *prlo, Search *more,
+                int num_more)
 {
   int i, j;
   int ret = 0;
-  double *pc = malloc((N + K) * sizeof *pc);          // mem:lumberer
-  double *direction = malloc(N * sizeof *direction);  // mem:diallings
-  double *pr = malloc(N * sizeof *pr);
-  corner_t cornmin[2];
+  int num = 2 * N + num_more;
+  double *pc = malloc((N + K) * sizeof *pc);                 // mem:lumberer
+  double *direction = calloc(2 * N * N, sizeof *direction);  // mem:diallings
+  double *pr = malloc(2 * N * N * sizeof *pr);               // mem:overfeeds
+  Search *searches = malloc(num * sizeof *searches);         // mem:reprobes
 
   /* Are there any included parameters? */
   if (N == 0) {
@@ -375,6 +895,36 @@ int margins(Configuration *C, const Space *S, double *prhi, double *prlo)
       lprintf(C, "       0\n");
     }
   }
+  /* the parameters that follow the principal components, and how */
+  for (j = 0; N + K > j; ++j) {
+    pc[j] = S[j].centerpnt;
+  }
+  if (C->num_components) {
+    int m = 0;
+    double kept = 0.0;
+    lprintf(C, "\nFollower                  Nominal  Sigma    Logs?");
+    for (j = N - C->num_components; N > j; ++j) {
+      lprintf(C, "%9.9s", C->params[j].name);
+    }
+    lprintf(C, "\n");
+    for (i = N + K; C->num_params_all > i; ++i) {
+      if (!C->params[i].load)
+        continue;
+      lprintf(C, "     %-19.19s %8.3f %8.4f %4d  ", C->params[i].name,
+              physspace(malt_at(pc, C, i), C, i), C->params[i].sigma, C->params[i].logs ? 1 : 0);
+      for (j = 0; C->num_components > j; ++j) {
+        lprintf(C, " %8.3f", C->params[i].load[j]);
+        kept += C->params[i].load[j] * C->params[i].load[j];
+      }
+      lprintf(C, "\n");
+      ++m;
+    }
+    lprintf(C,
+            "%d principal components keep %.1f%% of the variance of the %d correlated "
+            "parameters\n",
+            C->num_components, 100.0 * kept / m, m);
+  }
+  corners_probe(C, S);
   /* 1D Margins */
   lprintf(C, "\n1D Margins           ");
   /* pad it out with whitespace */
@@ -397,36 +947,41 @@ int margins(Configuration *C, const Space *S, double *prhi, double *prlo)
     lprintf(C, " ");
   }
   lprintf(C, "Low      High       Low      Nominal   High\n");
-  /* initialize */
+  /* lower margin & upper margin of every parameter, and the extra searches, in one batch */
   for (i = 0; N > i; ++i) {
-    for (j = 0; N > j; ++j) {
-      pc[j] = S[j].centerpnt;
-      direction[j] = 0.0;
-    }
-    /* lower margin & upper margin*/
     for (enum Direction d = DOWN; d <= UP; ++d) {
-      direction[i] = (d == UP) ? -1.0 : 1.0;  // note that up is -1 and down is 1
-      if (addpoint_corners(C, S, &cornmin[d], pr, pc, direction) == 0.0) {
-        fprintf(stderr, "Circuit failed for nominal parameter values\n");
-        goto fail;
-      }
-      /* used by opt & yield */
-      if (d == UP) {
-        prhi[i] = pr[i];
-      } else {
-        prlo[i] = pr[i];
-      }
+      int s = 2 * i + d;
+      direction[s * N + i] = (d == UP) ? -1.0 : 1.0;  // note that up is -1 and down is 1
+      searches[s] = SEARCH_INIT(pc, &direction[s * N], &pr[s * N]);
+    }
+  }
+  for (j = 0; num_more > j; ++j) {
+    searches[2 * N + j] = more[j];
+  }
+  addpoint_batch(C, S, searches, num, NULL, NULL);
+  for (j = 0; num_more > j; ++j) {
+    more[j] = searches[2 * N + j];
+  }
+
+  for (i = 0; N > i; ++i) {
+    Search *lo = &searches[2 * i + DOWN], *hi = &searches[2 * i + UP];
+    if (lo->margin == 0.0 || hi->margin == 0.0) {
+      fprintf(stderr, "Circuit failed for nominal parameter values\n");
+      goto fail;
     }
+    /* used by opt & yield */
+    prlo[i] = lo->pr[i];
+    prhi[i] = hi->pr[i];
     /* print a line */
     /* parameter name */
     lprintf(C, "%3d) %-19.19s", i + 1, C->params[i].name);
     /* the corners */
     for (j = 0; j < K; j++) {
-      lprintf(C, "%s", cornmin[DOWN] & (1 << j) ? "H" : "L");
+      lprintf(C, "%s", (lo->cornmin >> j) & 1 ? "H" : "L");
     }
     lprintf(C, " ");
     for (j = 0; j < K; j++) {
-      lprintf(C, "%s", cornmin[UP] & (1 << j) ? "H" : "L");
+      lprintf(C, "%s", (hi->cornmin >> j) & 1 ? "H" : "L");
     }
     /* the sigmas */
     lprintf(C, "     %7.2f%s %7.2f%s", (prlo[i] - S[i].centerpnt),
@@ -439,11 +994,195 @@ int margins(Configuration *C, const Space *S, double *prhi, double *prlo)
   }
   ret = 1;
 fail:
+  free(searches);   // mem:reprobes
+  free(pr);         // mem:overfeeds
   free(pc);         // mem:lumberer
   free(direction);  // mem:diallings
   return ret;
 }
 
+/* seed of the random directions and samples of screen() */
+#define SCREEN_SEED 0x5c7ee9
+/* samples of the model of screen() */
+#define SCREEN_SAMPLES 32768
+
+/* What screen() froze, for screen_check(): the 1-Yield the model says they miss, and the tolerance
+ * in percent it was held to. */
+static struct {
+  int num_frozen;
+  double missed, tol;
+} screened = {.num_frozen = 0};
+
+/* Counts the samples that fail in the model of screen(), whose terms are `w[s * N..]` and whose
+ * sums over the parameters that vary are `q[s]`, once parameter `i` (if not -1) stops varying
+ * too. */
+static long screen_failures(const Configuration *C, const double *w, const double *q, double k2,
+                            int i)
+{
+  long failures = 0;
+  for (int s = 0; SCREEN_SAMPLES > s; ++s)
+    failures += (q[s] - ((i < 0) ? 0.0 : w[s * N + i])) > k2;
+  return failures;
+}
+
+/* Holds the 1-Yield screen() estimated the frozen parameters miss against the simulated 1-Yield
+ * `q` of the rest, since screen() could only hold it against the 1-Yield of its own model. */
+void screen_check(const Configuration *C, double q)
+{
+  if (screened.num_frozen == 0)
+    return;
+  lprintf(C, "Screening: the %d frozen miss %.2e (model), %.1f%% of the simulated 1-Yield\n",
+          screened.num_frozen, screened.missed, q > 0.0 ? 100.0 * screened.missed / q : 100.0);
+  if (screened.missed > screened.tol / 100.0 * q)
+    lprintf(C, "warning: That is over screen=%.1f%%: the model of the margins is off here, and a "
+               "lower screen freezes fewer parameters\n",
+            screened.tol);
+}
+
+/* Excludes included normal parameter `i`, at its nominal value, moving it behind the others along
+ * with its S[i]; prhi[..] and prlo[..] close up. */
+static void freeze(Configuration *C, Space *S, double *prhi, double *prlo, int i)
+{
+  Param param = C->params[i];
+  Space space = S[i];
+  memmove(&C->params[i], &C->params[i + 1], (C->num_params_all - i - 1) * sizeof *C->params);
+  memmove(&S[i], &S[i + 1], (C->num_params_all - i - 1) * sizeof *S);
+  memmove(&prhi[i], &prhi[i + 1], (N - i - 1) * sizeof *prhi);
+  memmove(&prlo[i], &prlo[i + 1], (N - i - 1) * sizeof *prlo);
+  param.include = 0;
+  C->params[C->num_params_all - 1] = param;
+  S[C->num_params_all - 1] = space;
+  --C->num_params;
+  corners_freeze(C, i);
+}
+
+/* Screens out the included normal parameters that hardly limit the circuit, freezing them at their
+ * nominal values for the rest of the analysis.
+ *
+ * The operating region is modeled by the ellipsoid of each orthant through the 1D margins in
+ * prhi/prlo, scaled to the boundary points of `num_dirs` more searches along random directions if
+ * any. Gaussian samples of the model tell how much of 1-Yield is missed when some parameters stop
+ * varying. The parameter that misses the least is frozen, one after another, while all that is
+ * missed stays within `tol` percent of the 1-Yield of the model. The principal components of
+ * correlated parameters, and two parameters at least, are kept.
+ *
+ * prhi[..] and prlo[..] close up over the frozen parameters.
+ * Returns 0 on error. */
+int screen(Configuration *C, Space *S, double *prhi, double *prlo, double tol, int num_dirs)
+{
+  int ret = 0;
+  double *pc = malloc((N + K) * sizeof *pc);                   // mem:lutecium
+  double *dirs = malloc((num_dirs * N + 1) * sizeof *dirs);    // mem:sindry
+  double *prs = malloc((num_dirs * N + 1) * sizeof *prs);      // mem:curarize
+  double *w = malloc((size_t)SCREEN_SAMPLES * N * sizeof *w);  // mem:gallnut
+  double *q = malloc(SCREEN_SAMPLES * sizeof *q);              // mem:pyrolater
+  long *alone = malloc(N * sizeof *alone);                     // mem:unsour
+  int *frozen = calloc(N, sizeof *frozen);                     // mem:swinge
+  Search *searches = malloc((num_dirs + 1) * sizeof *searches);  // mem:nonsolar
+
+  for (int i = 0; N + K > i; ++i)
+    pc[i] = S[i].centerpnt;
+  /* the random directions, and how far out the model puts their boundary points */
+  for (int d = 0; num_dirs > d; ++d) {
+    double *dir = &dirs[d * N], len = 0.0;
+    counter_gauss(SCREEN_SEED, (uint64_t)d, dir, N);
+    for (int i = 0; N > i; ++i)
+      len += dir[i] * dir[i];
+    for (int i = 0; N > i; ++i)
+      dir[i] /= sqrt(len);
+    searches[d] = SEARCH_INIT(pc, dir, &prs[d * N]);
+    searches[d].skip_center = 1;  // the margins checked it
+  }
+  if (num_dirs) {
+    lprintf(C, "\nScreening along %d random directions\n", num_dirs);
+    addpoint_batch(C, S, searches, num_dirs, NULL, NULL);
+  }
+  double scale = 0.0;
+  for (int d = 0; num_dirs > d; ++d) {
+    if (searches[d].margin == 0.0) {
+      fprintf(stderr, "Circuit failed for nominal parameter values\n");
+      goto fail;
+    }
+    double qd = 0.0;
+    for (int i = 0; N > i; ++i) {
+      double v = prs[d * N + i] - S[i].centerpnt;
+      double h = (v < 0.0) ? S[i].centerpnt - prlo[i] : prhi[i] - S[i].centerpnt;
+      qd += (v / h) * (v / h);
+    }
+    scale += 0.5 * log(qd);
+  }
+  scale = num_dirs ? exp(scale / num_dirs) : 1.0;
+
+  /* the samples */
+  for (int s = 0; SCREEN_SAMPLES > s; ++s) {
+    double *ws = &w[s * N];
+    counter_gauss(SCREEN_SEED, (uint64_t)(num_dirs + s), ws, N);
+    q[s] = 0.0;
+    for (int i = 0; N > i; ++i) {
+      double h = (ws[i] < 0.0) ? S[i].centerpnt - prlo[i] : prhi[i] - S[i].centerpnt;
+      ws[i] = (ws[i] / h) * (ws[i] / h);
+      q[s] += ws[i];
+    }
+  }
+  double k2 = scale * scale;
+  long whole = screen_failures(C, w, q, k2, -1), left = whole;
+  for (int i = 0; N > i; ++i)
+    alone[i] = whole - screen_failures(C, w, q, k2, i);
+  /* freeze the parameter that misses the least, while within tolerance */
+  int num_frozen = 0;
+  for (;;) {
+    int best = -1;
+    long most = 0;
+    for (int i = 0; N - C->num_components > i; ++i) {
+      if (frozen[i] || num_frozen + 2 >= N)
+        continue;  // two are left for the yield at least
+      long failures = screen_failures(C, w, q, k2, i);
+      if (failures > most || best < 0) {
+        most = failures;
+        best = i;
+      }
+    }
+    if (best < 0 || (whole - most) > tol / 100.0 * whole)
+      break;
+    frozen[best] = 1;
+    ++num_frozen;
+    left = most;
+    for (int s = 0; SCREEN_SAMPLES > s; ++s)
+      q[s] -= w[s * N + best];
+  }
+
+  lprintf(C, "\nScreening                 1-Yield missed if frozen alone (model)\n");
+  for (int i = 0; N > i; ++i) {
+    lprintf(C, "%3d) %-19.19s %8.2e%s\n", i + 1, C->params[i].name,
+            (double)alone[i] / SCREEN_SAMPLES, frozen[i] ? "  frozen" : "");
+  }
+  if (num_dirs)
+    lprintf(C, "The random directions scale the model of the 1D margins by %.3f\n", scale);
+  lprintf(C, "1-Yield missed by the %d frozen: %.2e (model), %.1f%% of the model's 1-Yield %.2e\n",
+          num_frozen, (double)(whole - left) / SCREEN_SAMPLES,
+          whole ? 100.0 * (whole - left) / whole : 0.0, (double)whole / SCREEN_SAMPLES);
+  screened.num_frozen = num_frozen;
+  screened.missed = (double)(whole - left) / SCREEN_SAMPLES;
+  screened.tol = tol;
+  if (num_frozen) {
+    for (int i = N - 1; 0 <= i; --i)
+      if (frozen[i])
+        freeze(C, S, prhi, prlo, i);
+    pname(C);
+  }
+  ret = 1;
+fail:
+  free(searches);  // mem:nonsolar
+  free(frozen);    // mem:swinge
+  free(alone);     // mem:unsour
+  free(q);         // mem:pyrolater
+  free(w);         // mem:gallnut
+  free(prs);       // mem:curarize
+  free(dirs);      // mem:sindry
+  free(pc);        // mem:lutecium
+  return ret;
+}
+
 int tmargins(Configuration *C, const Space *S)
 {
   int i, j, k;
@@ -601,6 +1340,10 @@ Plane **plane_malloc(Plane **plane, int *plnmemory, int inc, int dim)
       return NULL;
     }
     /* from 0 to dim-1 */
+    if ((new[i]->adj = malloc(dim * sizeof *new[i]->adj)) == NULL) {  // mem:outflank
+      return NULL;
+    }
+    /* from 0 to dim-1 */
     if ((new[i]->a = malloc(dim * sizeof *new[i]->a)) == NULL) {  // mem:unlugubrious
       return NULL;
     }
@@ -615,6 +1358,7 @@ void plane_free(Plane **plane, int plnmemory)
 
   for (i = 0; i < plnmemory; i++) {
     free(plane[i]->points);  // mem:impresting
+    free(plane[i]->adj);     // mem:outflank
     free(plane[i]->a);       // mem:unlugubrious
     free(plane[i]);          // mem:pathogenicity
   }
@@ -650,7 +1394,62 @@ void margpnts_free(double **margpnts, int pntmemory)
   free(margpnts);       // mem:contemporaneous
 }
 
-void intpickpnts(short *pntstack, Configuration *C, const Space *S, int depth, Plane **plane,
+/* vertices of the ridges that hull_link() matches, for by_ridge() */
+static int ridge_len;
+
+/* Orders ridges by their (sorted) vertices. */
+static int by_ridge(const void *a, const void *b)
+{
+  const vertex_t *x = a, *y = b;
+  for (int i = 0; ridge_len > i; ++i)
+    if (x[i] != y[i])
+      return (x[i] < y[i]) ? -1 : 1;
+  return 0;
+}
+
+/* Links the planes plane[from..to] among themselves: across each ridge whose neighbor is not known
+ * yet, the plane that has the same N-1 points. */
+static void hull_link(const Configuration *C, Plane **plane, int from, int to)
+{
+  /* a ridge is its N-1 points in order, then its plane and the point it leaves out */
+  int len = N + 1, num = 0;
+  vertex_t *ridges = malloc((size_t)(to - from) * N * len * sizeof *ridges);  // mem:bipinnate
+
+  for (int f = from; to > f; ++f) {
+    for (int k = 0; N > k; ++k) {
+      if (plane[f]->adj[k] >= 0)
+        continue;
+      vertex_t *r = &ridges[num++ * len];
+      int m = 0;
+      for (int i = 0; N > i; ++i) {
+        if (i == k)
+          continue;
+        vertex_t v = plane[f]->points[i];
+        int j = m++;
+        for (; j > 0 && r[j - 1] > v; --j)
+          r[j] = r[j - 1];
+        r[j] = v;
+      }
+      r[N - 1] = f;
+      r[N] = k;
+    }
+  }
+  ridge_len = N - 1;
+  qsort(ridges, num, len * sizeof *ridges, by_ridge);
+  for (int r = 0; num - 1 > r; ++r) {
+    const vertex_t *x = &ridges[r * len], *y = x + len;
+    if (by_ridge(x, y) == 0) {
+      plane[x[N - 1]]->adj[x[N]] = y[N - 1];
+      plane[y[N - 1]]->adj[y[N]] = x[N - 1];
+      ++r;
+    }
+  }
+  free(ridges);  // mem:bipinnate
+}
+
+/* Makes the first hull, a plane through one of the two 1D margins of every parameter in each
+ * quadrant, and links the planes to their neighbors. */
+void intpickpnts(vertex_t *pntstack, Configuration *C, const Space *S, int depth, Plane **plane,
                  double **margpnts, int *plncount, int pntcount)
 {
   for (pntstack[depth] = depth * 2; 2 + depth * 2 > pntstack[depth]; ++pntstack[depth])
@@ -658,22 +1457,17 @@ void intpickpnts(short *pntstack, Configuration *C, const Space *S, int depth, P
       makeaplane(pntstack, C, S, plane, margpnts, plncount, pntcount);
     else
       intpickpnts(pntstack, C, S, depth + 1, plane, margpnts, plncount, pntcount);
+  if (depth == 0)
+    hull_link(C, plane, 0, *plncount);
 }
 
-int makeaplane(short *pntstack, Configuration *C, const Space *S, Plane **plane, double **margpnts,
-               int *plncount, int pntcount)
+/* Computes the (unnormalized) hyperplane b + a.x = 0 through the N points in `pntstack`. */
+static double plane_through(const vertex_t *pntstack, const Configuration *C, double **margpnts,
+                            double *a, double **aNmatrix)
 {
-  double distance, sumsqr, norm;
-  int i, j, k, posd, negd, pntinpln;
-  static int allocate = 1;
-  static double b, *a, **aNmatrix;
+  double b;
+  int i, j, k;
 
-  /* Dynamically allocate local vector and matrix, just once */
-  if (allocate) {
-    a = vector(0, N - 1);
-    aNmatrix = matrix(1, N, 1, N);
-    allocate = 0;
-  }
   /* B */
   for (i = 0; N > i; ++i)
     for (j = 0; N > j; ++j)
@@ -688,6 +1482,49 @@ int makeaplane(short *pntstack, Configuration *C, const Space *S, Plane **plane,
     }
     a[k] = det_dim(aNmatrix, N);
   }
+  return b;
+}
+
+/* Normalizes the plane b + a.x = 0 and stores it in `plane`, oriented so the center is on its
+ * positive side. */
+static void plane_store(const Configuration *C, const Space *S, Plane *plane,
+                        const vertex_t *pntstack, double b, double *a)
+{
+  double distance, sumsqr, norm;
+  int k;
+
+  /* normalize */
+  for (k = 0, sumsqr = 0.0; k < N; k++)
+    sumsqr += a[k] * a[k];
+  norm = 1.0 / (sqrt(sumsqr));
+  for (k = 0, b *= norm; k < N; k++)
+    a[k] *= norm;
+  for (k = 0, distance = b; k < N; k++)
+    distance += a[k] * S[k].centerpnt;
+  if (distance < 0.0)
+    for (k = 0, b *= -1.0; k < N; k++)
+      a[k] *= -1.0;
+  for (k = 0, plane->b = b; k < N; k++)
+    plane->a[k] = a[k];
+  for (k = 0, plane->flag = 0; k < N; k++)
+    plane->points[k] = pntstack[k];
+}
+
+int makeaplane(vertex_t *pntstack, Configuration *C, const Space *S, Plane **plane,
+               double **margpnts, int *plncount, int pntcount)
+{
+  double distance;
+  int i, j, k, posd, negd, pntinpln;
+  static int allocate = 1;
+  static double b, *a, **aNmatrix;
+
+  /* Dynamically allocate local vector and matrix, just once */
+  if (allocate) {
+    a = vector(0, N - 1);
+    aNmatrix = matrix(1, N, 1, N);
+    allocate = 0;
+  }
+  b = plane_through(pntstack, C, margpnts, a, aNmatrix);
   /* check that all points (not in the plane) are on the same side of the plane */
   for (j = 0, posd = 0, negd = 0; !(posd && negd) && pntcount > j; j++) {
     for (i = 0, pntinpln = 0; !pntinpln && N > i; i++)
@@ -703,27 +1540,156 @@ int makeaplane(short *pntstack, Configuration *C, const Space *S, Plane **plane,
   }
   /* save the plane if it is good */
   if (!(posd && negd)) {
-    /* normalize */
-    for (k = 0, sumsqr = 0.0; k < N; k++)
-      sumsqr += a[k] * a[k];
-    norm = 1.0 / (sqrt(sumsqr));
-    for (k = 0, b *= norm; k < N; k++)
-      a[k] *= norm;
-    for (k = 0, distance = b; k < N; k++)
-      distance += a[k] * S[k].centerpnt;
-    if (distance < 0.0)
-      for (k = 0, b *= -1.0; k < N; k++)
-        a[k] *= -1.0;
     /* store plane in global array */
-    for (k = 0, plane[*plncount]->b = b; k < N; k++)
-      plane[*plncount]->a[k] = a[k];
-    for (k = 0, plane[*plncount]->flag = 0; k < N; k++)
-      plane[*plncount]->points[k] = pntstack[k];
+    plane_store(C, S, plane[*plncount], pntstack, b, a);
+    for (k = 0; N > k; ++k)
+      plane[*plncount]->adj[k] = -1;
     ++*plncount;
   }
   return 1;
 }
 
+/* The work space of replane and hull_add: a plane's normal, the matrix that solves for it, and
+ * its points. Allocated just once. */
+static double *hull_a, **hull_aNmatrix;
+static vertex_t *hull_pntstack;
+
+static void hull_scratch(const Configuration *C)
+{
+  if (hull_a == NULL) {
+    hull_a = vector(0, N - 1);
+    hull_aNmatrix = matrix(1, N, 1, N);
+    hull_pntstack = malloc(N * sizeof *hull_pntstack);
+  }
+}
+
+/* Recomputes a stored plane after some of its points have moved, keeping the flag. */
+void replane(Configuration *C, const Space *S, Plane *plane, double **margpnts)
+{
+  short flag = plane->flag;
+
+  hull_scratch(C);
+  for (int k = 0; N > k; ++k)
+    hull_pntstack[k] = plane->points[k];
+  plane_store(C, S, plane, hull_pntstack,
+              plane_through(hull_pntstack, C, margpnts, hull_a, hull_aNmatrix), hull_a);
+  plane->flag = flag;
+}
+
+/* is the point beyond (on the outer side of) the plane? */
+static int beyond(const Configuration *C, const Plane *plane, const double *pnt)
+{
+  double distance = plane->b;
+  for (int k = 0; N > k; ++k)
+    distance += plane->a[k] * pnt[k];
+  return distance < 0.0;
+}
+
+/* Appends plane n to the planes seen, growing them as needed. */
+static int *seen_push(int *seen, int *num_seen, int *seen_memory, int n)
+{
+  if (*num_seen == *seen_memory) {
+    *seen_memory = *seen_memory ? 2 * *seen_memory : 64;
+    seen = realloc(seen, *seen_memory * sizeof *seen);  // mem:lodestar
+  }
+  seen[(*num_seen)++] = n;
+  return seen;
+}
+
+static int by_index_down(const void *a, const void *b)
+{
+  int x = *(const int *)a, y = *(const int *)b;
+  return (x < y) - (x > y);
+}
+
+/* Adds margpnts[pnt] to the hull: the planes it is beyond are found by walking from plane `from`
+ * to their neighbors, and are replaced by planes through the point and the ridges around them.
+ * The work goes with the number of planes the point sees, not with the size of the hull.
+ *
+ * Returns the number of planes replaced, 0 if the point is inside the hull. */
+int hull_add(Configuration *C, const Space *S, Plane ***planes, int *plnmemory, int *plncount,
+             double **margpnts, int pnt, int from)
+{
+  Plane **plane = *planes;
+  int num_seen = 0, seen_memory = 0, first = *plncount;
+  int *seen = NULL;
+  double *a, **aNmatrix;
+  vertex_t *pntstack;
+
+  hull_scratch(C);
+  a = hull_a, aNmatrix = hull_aNmatrix, pntstack = hull_pntstack;
+  /* the search went out through plane `from`; if rounding has the point short of it, scan */
+  if (!beyond(C, plane[from], margpnts[pnt]))
+    for (from = 0; *plncount > from && !beyond(C, plane[from], margpnts[pnt]); ++from)
+      ;
+  if (from == *plncount)
+    return 0;
+  /* walk the planes the point sees */
+  plane[from]->flag = 2;
+  seen = seen_push(seen, &num_seen, &seen_memory, from);
+  for (int v = 0; num_seen > v; ++v) {
+    for (int k = 0; N > k; ++k) {
+      int n = plane[seen[v]]->adj[k];
+      if (n < 0 || plane[n]->flag == 2 || !beyond(C, plane[n], margpnts[pnt]))
+        continue;
+      plane[n]->flag = 2;
+      seen = seen_push(seen, &num_seen, &seen_memory, n);
+    }
+  }
+  /* a new plane through the point for each ridge between a seen and an unseen plane */
+  for (int v = 0; num_seen > v; ++v) {
+    for (int k = 0; N > k; ++k) {
+      Plane *old = plane[seen[v]];
+      int n = old->adj[k];
+      if (n >= 0 && plane[n]->flag == 2)
+        continue;
+      /* allocate more planes in memory */
+      if (*plncount == *plnmemory) {
+        if ((plane = plane_malloc(plane, plnmemory, *plncount / 3 + 1, N)) == NULL) {
+          perror("No more memory\n");
+          exit(EXIT_FAILURE);
+        }
+        *planes = plane;
+      }
+      for (int j = 0; N > j; ++j)
+        pntstack[j] = old->points[j];
+      pntstack[k] = pnt;
+      plane_store(C, S, plane[*plncount], pntstack,
+                  plane_through(pntstack, C, margpnts, a, aNmatrix), a);
+      for (int j = 0; N > j; ++j)
+        plane[*plncount]->adj[j] = -1;
+      /* the new plane takes over the ridge from the old one */
+      plane[*plncount]->adj[k] = n;
+      if (n >= 0)
+        for (int j = 0; N > j; ++j)
+          if (plane[n]->adj[j] == seen[v])
+            plane[n]->adj[j] = *plncount;
+      ++*plncount;
+    }
+  }
+  /* the new planes meet each other across the ridges through the point */
+  hull_link(C, plane, first, *plncount);
+  /* delete the seen planes, the last plane taking the place of each */
+  qsort(seen, num_seen, sizeof *seen, by_index_down);
+  for (int v = 0; num_seen > v; ++v) {
+    int last = --*plncount, to = seen[v];
+    Plane *swap = plane[to];
+    if (to == last)
+      continue;
+    plane[to] = plane[last];
+    plane[last] = swap;
+    for (int k = 0; N > k; ++k) {
+      int n = plane[to]->adj[k];
+      if (n >= 0)
+        for (int j = 0; N > j; ++j)
+          if (plane[n]->adj[j] == last)
+            plane[n]->adj[j] = to;
+    }
+  }
+  free(seen);  // mem:lodestar
+  return num_seen;
+}
+
 /* is the point inside the hull? */
 /* if so, the distance to each hull plane should be positive */
 int hull_dice(Configuration *C, double *pc, Plane **plane, int plncount)
@@ -746,13 +1712,19 @@ int center(Configuration *C, Space *S, Plane **plane, int *tang, int plncount, d
 {
   double **tab;
   int *right, *left;
-  int x, y, tangent;
+  int x, y, i, tangent;
+  /* the nominals are bounded along each coordinate, and along each follower of the principal
+   * components */
+  int M = N;
+  for (i = N + K; C->num_params_all > i; ++i)
+    M += C->params[i].load != NULL;
+  double *e = calloc(N, sizeof *e);  // mem:gunlocks
 
   /* *** is it wasteful to keep allocating over and over again? *** */
   /* allocate local vector and matrix */
-  tab = matrix(1, N + 3, 1, plncount + 1 + 2 * N);  // mem:albronze
+  tab = matrix(1, N + 3, 1, plncount + 1 + 2 * M);  // mem:albronze
   left = ivector(1, N + 1);                         // mem:isolative
-  right = ivector(1, plncount + 2 * N);             // mem:intrusional
+  right = ivector(1, plncount + 2 * M);             // mem:intrusional
   /* inscribe the sphere */
   /* initialize the input tabeau */
   for (y = 0; N >= y; ++y)
@@ -760,31 +1732,36 @@ int center(Configuration *C, Space *S, Plane **plane, int *tang, int plncount, d
   tab[N + 2][1] = 1.0;
   for (x = 1; plncount >= x; ++x)
     tab[1][x + 1] = -plane[x - 1]->b;
-  for (x = 1; N >= x; ++x) {
-    tab[1][x * 2 + plncount] = -(C->params[x - 1].nom_max + INSCRIBE);
-    tab[1][x * 2 + 1 + plncount] = C->params[x - 1].nom_min - INSCRIBE;
+  for (x = 1, i = 0; C->num_params_all > i; ++i) {
+    if (N <= i && !C->params[i].load)
+      continue;
+    double nominal = (N <= i) ? maltspace(C->params[i].nominal, C, i) : 0.0;
+    tab[1][x * 2 + plncount] = -(C->params[i].nom_max - nominal + INSCRIBE);
+    tab[1][x * 2 + 1 + plncount] = C->params[i].nom_min - nominal - INSCRIBE;
+    for (y = 1; N >= y; ++y) {
+      e[y - 1] = 1.0;
+      tab[y + 1][x * 2 + plncount] = -malt_along(e, C, i);
+      tab[y + 1][x * 2 + 1 + plncount] = malt_along(e, C, i);
+      e[y - 1] = 0.0;
+    }
+    ++x;
   }
   for (x = 1; plncount >= x; ++x)
     tab[N + 2][x + 1] = -1.0;
-  for (x = plncount + 1; plncount + 2 * N >= x; ++x)
+  for (x = plncount + 1; plncount + 2 * M >= x; ++x)
     tab[N + 2][x + 1] = 0.0;
   for (y = 1; N >= y; ++y)
     for (x = 1; plncount >= x; ++x)
       tab[y + 1][x + 1] = plane[x - 1]->a[y - 1];
-  for (y = 1; N >= y; ++y)
-    for (x = 1; N >= x; ++x) {
-      tab[y + 1][x * 2 + plncount] = (y == x ? -1.0 : 0.0);
-      tab[y + 1][x * 2 + 1 + plncount] = (y == x ? 1.0 : 0.0);
-    }
   /* call the linear program */
-  if (0 != simplx(tab, N + 1, plncount + 2 * N, right, left)) {
+  if (0 != simplx(tab, N + 1, plncount + 2 * M, right, left)) {
     tangent = 0;
     goto Bailed;
   }
   *radius = -tab[1][1];
   for (y = 1; N >= y; ++y)
-    for (x = 1; plncount + 2 * N >= x; ++x)
-      if (right[x] == y + plncount + 2 * N)
+    for (x = 1; plncount + 2 * M >= x; ++x)
+      if (right[x] == y + plncount + 2 * M)
         S[y - 1].centerpnt = -tab[1][x + 1];
   for (x = 0, y = 1; N + 1 >= y; ++y)
     if (left[y] <= plncount)
@@ -792,19 +1769,20 @@ int center(Configuration *C, Space *S, Plane **plane, int *tang, int plncount, d
   tangent = x;
 Bailed:
   /* free local memory */
-  free_matrix(tab, 1, N + 3, 1, plncount + 1 + 2 * N);  // mem:albronze
+  free_matrix(tab, 1, N + 3, 1, plncount + 1 + 2 * M);  // mem:albronze
   free_ivector(left, 1, N + 1);                         // mem:isolative
-  free_ivector(right, 1, plncount + 2 * N);             // mem:intrusional
+  free_ivector(right, 1, plncount + 2 * M);             // mem:intrusional
+  free(e);                                              // mem:gunlocks
   return tangent;
 }
 
-int findface(int dim, double *facecenter, Plane **plane, int *tang, int plncount, int tangent)
+int findface(int dim, double *facecenter, Plane **plane, int *tang, int tangent)
 {
   double **tab;
   double *sine;
   double cos, facevalue = 0.0;
   int *left, *intsect, *right;
-  int x, y, z, i, large, share, noshare, count, face = -1;
+  int x, y, i, large, count, face = -1;
 
   /* *** is it wasteful to keep allocating over and over again? *** */
   /* allocate local vector and matrix */
@@ -818,19 +1796,10 @@ int findface(int dim, double *facecenter, Plane **plane, int *tang, int plncount
     /*   for (i=0; dim+1-pin > i; ++i) { */
     large = tang[i];
     if (!plane[large]->flag) {
-      /* find the intersecting planes, which share N-1 points (noshare is 1) */
-      for (x = 1, count = 0; plncount >= x; ++x) {
-        for (y = 1, noshare = 0; noshare < 2 && dim >= y; ++y) {
-          for (z = 1, share = 0; !share && dim >= z; ++z) {
-            share = (plane[large]->points[z - 1] == plane[x - 1]->points[y - 1]);
-          }
-          if (!share)
-            ++noshare;
-        }
-        if (noshare == 1)
-          if (count++ <= dim)
-            intsect[count] = x - 1;
-      }
+      /* the intersecting planes, which share N-1 points */
+      for (x = 1, count = 0; dim >= x; ++x)
+        if ((intsect[x] = plane[large]->adj[x - 1]) >= 0)
+          ++count;
       if (count != dim) {
         /* planes are screwed up (e.g. if operating region has a planar surface), so delete it */
         /*  printf("How odd: count=%d dim=%d\n", count, dim); */
@@ -5,30 +5,75 @@
 
 #include "config.h"
 #include "space.h"
+#include <stdint.h>
+
+/* index of a boundary point among those found so far, in the simplexes of cropc and the planes of
+ * optimize */
+typedef int vertex_t;
 
 typedef struct {
   short flag;
-  unsigned short *points;
+  vertex_t *points;
+  int *adj; /* adj[k]: the plane across the ridge opposite points[k], or -1 if not known */
   double b;
   double *a;
 } Plane;
 
-typedef unsigned int corner_t;
+/* a corner: bit j is set when corner parameter j is at its high corner value */
+typedef uint64_t corner_t;
+
+/* A search for the boundary of the operating area along one direction, at all corners. Without a
+ * direction, it is a point-check of pc at all corners instead. */
+typedef struct search {
+  const double *pc;         /* center of the search in (N+K)d space */
+  const double *direction;  /* unit vector in (N)d space, negative-wise, or NULL to point-check */
+  double *pr;               /* if not NULL, receives the boundary point at the limiting corner */
+  corner_t cornmin;         /* ordinal value of the limiting corner (or the first that failed) */
+  double margin;            /* distance from pc in units of sigma, or 0.0 if pc failed */
+                            /* (INFINITY if a point-check passed) */
+  int pending;              /* number of corners not yet finished */
+  int skip_center;          /* pc is known to pass at all corners, so it is not simulated again */
+} Search;
+
+#define SEARCH_INIT(pc_, direction_, pr_)                                              \
+  (Search)                                                                             \
+  {                                                                                    \
+    .pc = (pc_), .direction = (direction_), .pr = (pr_), .cornmin = 0, .margin = 0.0, \
+    .pending = 0, .skip_center = 0                                                     \
+  }
 
 void makeiter(Configuration *, char);
 int checkiter(Configuration *);
 int tmargins(Configuration *, const Space *);
+int screen(Configuration *C, Space *S, double *prhi, double *prlo, double tol, int num_dirs)
+    __attribute__((nonnull));
+void screen_check(const Configuration *C, double q) __attribute__((nonnull));
 int margins(Configuration *C, const Space *S, double *prhi, double *prlo) __attribute__((nonnull));
+int margins_and(Configuration *C, const Space *S, double *prhi, double *prlo, Search *more,
+                int num_more) __attribute__((nonnull(1, 2, 3, 4)));
 double addpoint_corners(const Configuration *C, const Space *S, corner_t *cornmin, double *pr,
                         const double *pc, const double *direction);
+int addpoint_batch(const Configuration *C, const Space *S, Search *searches, int num,
+                   void (*done)(Search *, void *), void *ctx);
+void corners_probe(const Configuration *C, const Space *S);
+int corners_per_search(const Configuration *C);
+void corners_unscreen(void);
+int budget_allows(const Configuration *C, int searches);
+int budget_fits(const Configuration *C, int searches);
+void budget_open(Configuration *C);
+void budget_close(void);
+void budget_report(const Configuration *C);
+long budget_sims(void);
 Plane **plane_malloc(Plane **, int *, int, int);
 void plane_free(Plane **, int);
 double **margpnts_malloc(double **, int *, int, int);
 void margpnts_free(double **, int);
-void intpickpnts(short *, Configuration *, const Space *, int, Plane **, double **, int *, int);
-int makeaplane(short *, Configuration *, const Space *, Plane **, double **, int *, int);
+void intpickpnts(vertex_t *, Configuration *, const Space *, int, Plane **, double **, int *, int);
+int makeaplane(vertex_t *, Configuration *, const Space *, Plane **, double **, int *, int);
+void replane(Configuration *, const Space *, Plane *, double **);
+int hull_add(Configuration *, const Space *, Plane ***, int *, int *, double **, int, int);
 int center(Configuration *, Space *, Plane **, int *, int, double *);
-int findface(int, double *, Plane **, int *, int, int);
+int findface(int, double *, Plane **, int *, int);
 double det_dim(double **, int);
 int simplx(double *const *, int, int, int *, int *);
 int hull_dice(Configuration *, double *, Plane **, int);
@@ -0,0 +1,426 @@
+// vi: ts=2 sts=2 sw=2 et tw=100
+/* Monte Carlo yield: pass/fail point-checks of parameter vectors drawn about the nominal, or
+ * boundary searches along quasi-random directions */
+#include "montecarlo.h"
+#include "call_spice.h"
+#include "config.h"
+#include "malt.h"
+#include "marg_opt_yield.h"
+#include "space.h"
+#include "stat_math.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define N (C->num_params)
+#define K (C->num_params_corn)
+
+/* options.mc_method */
+enum { PLAIN, IMPORTANCE, DIRECTIONAL };
+static const char *const method_names[] = {"plain", "importance", "directional"};
+
+/* The importance sampling proposal: a mixture of unit normal distributions, one about the nominal
+ * and one about each boundary point found by the margins, in (N)d malt space relative to the
+ * nominal. */
+typedef struct proposal {
+  int num;        // components, the nominal first
+  double *shift;  // center of each component, num * N
+  double *half;   // half of the square of the length of each shift
+  double *log_w;  // log of the weight of each component
+  double *cum;    // weights summed up to each component, for the draw
+} Proposal;
+
+/* share of the samples drawn about the nominal, so that failures the margins missed still count */
+#define DEFENSIVE 0.1
+
+/* one round of samples, counted in the order they were drawn as their point-checks finish */
+typedef struct mc_round {
+  Configuration *C;
+  Search *searches;
+  int *sample;        // sample (within the round) of each search
+  signed char *fail;  // 1 failed, 0 passed, -1 not yet known, for each sample of the round
+  double *ratio;      // what a failure of each sample of the round counts for: its likelihood
+                      // ratio, or for directional sampling the probability beyond its margin
+  int num;            // samples in the round
+  int num_searches;   // point-checks in the round, of the samples in the parameter ranges
+  int counted;        // samples of the round already counted
+  long samples;       // samples counted in all, in order
+  long fails;         // failures among them
+  double sum, sum2;   // sum of the likelihood ratios of the failures, and of their squares
+  long next_report;   // sample count of the next line of the table
+  int stop;           // the confidence interval is narrow enough: the rest are not counted
+} McRound;
+
+/* Stores in *lo and *hi the Wilson score 95% confidence interval of the failure probability, after
+ * `fails` failures in `samples` samples. Unlike the normal approximation, it stays within [0, 1]
+ * and is not empty when there are no failures yet. */
+static void wilson(long fails, long samples, double *lo, double *hi)
+{
+  const double z = 1.96;
+  double p = (double)fails / samples, z2n = z * z / samples;
+  double center = (p + z2n / 2.0) / (1.0 + z2n);
+  double half = z / (1.0 + z2n) * sqrt(p * (1.0 - p) / samples + z2n / (4.0 * samples));
+
+  *lo = fmax(center - half, 0.0);
+  *hi = fmin(center + half, 1.0);
+}
+
+/* Stores in *lo and *hi the 95% confidence interval of 1-Yield so far, and returns 1-Yield: the
+ * Wilson interval for plain sampling, or else the normal one from the standard error of the
+ * weighted estimate. */
+static double mc_interval(const Configuration *C, const McRound *R, double *lo, double *hi)
+{
+  double p = R->sum / R->samples;
+
+  if (C->options.mc_method == PLAIN) {
+    wilson(R->fails, R->samples, lo, hi);
+  } else {
+    double se = R->samples > 1 ? sqrt(fmax(R->sum2 / R->samples - p * p, 0.0) / (R->samples - 1))
+                               : INFINITY;
+    *lo = fmax(p - 1.96 * se, 0.0);
+    *hi = p + 1.96 * se;
+  }
+  return p;
+}
+
+static void mc_line(const Configuration *C, const McRound *R)
+{
+  double lo, hi, p = mc_interval(C, R, &lo, &hi);
+
+  if (C->options.mc_method == DIRECTIONAL)
+    lprintf(C, "%8ld             %4.2e   %4.2e to %4.2e\n", R->samples, p, lo, hi);
+  else
+    lprintf(C, "%8ld %9ld   %4.2e   %4.2e to %4.2e\n", R->samples, R->fails, p, lo, hi);
+}
+
+/* Counts the samples of the round that are known, in order, up to the first that is not. Prints a
+ * line at every doubling of the count, and stops once the confidence interval is within
+ * mc_confidence percent of 1-Yield. */
+static void mc_count(McRound *R)
+{
+  Configuration *C = R->C;
+
+  while (!R->stop && R->counted < R->num && R->fail[R->counted] >= 0) {
+    if (R->fail[R->counted]) {
+      R->fails++;
+      R->sum += R->ratio[R->counted];
+      R->sum2 += R->ratio[R->counted] * R->ratio[R->counted];
+    }
+    R->counted++;
+    if (++R->samples == R->next_report) {
+      mc_line(C, R);
+      R->next_report *= 2;
+    }
+    if (C->options.mc_confidence > 0.0 && R->fails > 0) {
+      double lo, hi, p = mc_interval(C, R, &lo, &hi);
+      if (hi - p <= p * C->options.mc_confidence / 100.0 &&
+          p - lo <= p * C->options.mc_confidence / 100.0)
+        R->stop = 1;
+    }
+  }
+}
+
+/* Called by addpoint_batch as each point-check or search finishes at all its corners. A direction
+ * counts for the probability of the normal distribution beyond its margin, which is exact when the
+ * operating region is star-shaped about the nominal. */
+static void mc_done(Search *search, void *ctx)
+{
+  McRound *R = ctx;
+  Configuration *C = R->C;
+  int s = R->sample[search - R->searches];
+
+  if (C->options.mc_method == DIRECTIONAL) {
+    R->ratio[s] = gauss_integral_c(search->margin, N);
+    R->fail[s] = 1;
+  } else {
+    R->fail[s] = search->margin == 0.0;
+  }
+  mc_count(R);
+  if (R->stop) {
+    /* the rest are not counted: the batch skips what is left of a search that failed */
+    for (int s = 0; R->num_searches > s; ++s)
+      if (R->searches[s].pending > 0)
+        R->searches[s].margin = 0.0;
+  }
+}
+
+/* Sets up the proposal of importance sampling about the boundary points of the 2N axis margins and,
+ * up to N = 10 (as for the corners mesh of -y), of the 2^N corner vectors, found in one batch. Each
+ * point is weighted by the normal density there, which is roughly its share of the failures.
+ * Returns 0 if the nominal fails. */
+static int proposal_init(Configuration *C, const Space *S, Proposal *P)
+{
+  int ret = 0;
+  int num_corn = (N > 10) ? 0 : 1 << N;
+  double *prhi = malloc(N * sizeof *prhi);               // mem:palama
+  double *prlo = malloc(N * sizeof *prlo);               // mem:cadying
+  double *pc = malloc((N + K) * sizeof *pc);             // mem:bedrail
+  double *dirs = malloc(num_corn * N * sizeof *dirs);    // mem:unwedged
+  double *prs = malloc(num_corn * N * sizeof *prs);      // mem:maskegs
+  Search *corners = malloc(num_corn * sizeof *corners);  // mem:tawnies
+  P->num = 1 + 2 * N + num_corn;
+  P->shift = calloc(P->num * N, sizeof *P->shift);  // mem:rimples
+  P->half = malloc(P->num * sizeof *P->half);       // mem:slaggy
+  P->log_w = malloc(P->num * sizeof *P->log_w);     // mem:venules
+  P->cum = malloc(P->num * sizeof *P->cum);         // mem:arointed
+
+  for (int i = 0; N + K > i; ++i)
+    pc[i] = S[i].centerpnt;
+  for (int k = 0; num_corn > k; ++k) {
+    for (int i = 0; N > i; ++i)
+      dirs[k * N + i] = (k >> i & 1) ? -0.5 : 0.5;  // direction is negative-wise
+    corners[k] = SEARCH_INIT(pc, &dirs[k * N], &prs[k * N]);
+    /* the margins check the center first, so it need not be simulated again */
+    corners[k].skip_center = 1;
+  }
+  if (!margins_and(C, S, prhi, prlo, corners, num_corn))
+    goto fail;
+
+  /* the shifts: the nominal, the axis margins, then the corner vectors */
+  for (int i = 0; N > i; ++i) {
+    P->shift[(1 + 2 * i) * N + i] = prlo[i] - S[i].centerpnt;
+    P->shift[(2 + 2 * i) * N + i] = prhi[i] - S[i].centerpnt;
+  }
+  for (int k = 0; num_corn > k; ++k)
+    for (int i = 0; N > i; ++i)
+      P->shift[(1 + 2 * N + k) * N + i] = prs[k * N + i] - S[i].centerpnt;
+  double nearest = INFINITY, total = 0.0;
+  for (int c = 0; P->num > c; ++c) {
+    double r2 = 0.0;
+    for (int i = 0; N > i; ++i)
+      r2 += P->shift[c * N + i] * P->shift[c * N + i];
+    P->half[c] = r2 / 2.0;
+    if (c > 0 && nearest > r2)
+      nearest = r2;
+  }
+  /* normal densities relative to that of the nearest point, so that they do not underflow */
+  for (int c = 1; P->num > c; ++c)
+    total += exp(nearest / 2.0 - P->half[c]);
+  P->log_w[0] = log(DEFENSIVE);
+  for (int c = 1; P->num > c; ++c)
+    P->log_w[c] = log((1.0 - DEFENSIVE) / total) + nearest / 2.0 - P->half[c];
+  for (int c = 0; P->num > c; ++c)
+    P->cum[c] = exp(P->log_w[c]) + (c > 0 ? P->cum[c - 1] : 0.0);
+  lprintf(C, "\nImportance sampling about %d boundary points, the nearest at %.2f sigma\n",
+          P->num - 1, sqrt(nearest));
+  ret = 1;
+fail:
+  free(corners);  // mem:tawnies
+  free(prs);      // mem:maskegs
+  free(dirs);     // mem:unwedged
+  free(pc);       // mem:bedrail
+  free(prlo);     // mem:cadying
+  free(prhi);     // mem:palama
+  return ret;
+}
+
+static void proposal_free(Proposal *P)
+{
+  free(P->cum);    // mem:arointed
+  free(P->log_w);  // mem:venules
+  free(P->half);   // mem:slaggy
+  free(P->shift);  // mem:rimples
+}
+
+/* Draws a sample from the proposal, given N+1 normal deviates z[0..N]: z[N] picks the component
+ * and z[0..N-1] are the offset from its center. Stores the sample, relative to the nominal, in
+ * x[0..N-1] and returns its likelihood ratio, the normal density over the proposal density. */
+static double proposal_draw(const Configuration *C, const Proposal *P, const double *z, double *x)
+{
+  double u = 0.5 * erfc(-z[N] / M_SQRT2) * P->cum[P->num - 1];
+  int c = 0;
+
+  while (P->num - 1 > c && u >= P->cum[c])
+    ++c;
+  for (int i = 0; N > i; ++i)
+    x[i] = P->shift[c * N + i] + z[i];
+  /* q(x)/phi(x) = sum of w_c exp(x.shift_c - |shift_c|^2/2), summed in logs */
+  double big = -INFINITY, sum = 0.0;
+  for (int d = 0; P->num > d; ++d) {
+    double e = P->log_w[d] - P->half[d];
+    for (int i = 0; N > i; ++i)
+      e += x[i] * P->shift[d * N + i];
+    if (e > big) {
+      sum = sum * exp(big - e) + 1.0;
+      big = e;
+    } else {
+      sum += exp(e - big);
+    }
+  }
+  return exp(-big) / sum;
+}
+
+/* Estimates the yield by drawing parameter vectors from the normal distribution about the nominal
+ * (one sigma is one unit of malt space) and checking that each passes at all corners (at those it
+ * is screened down to, with [corners] screen, and all of them for the audited ones). Sample i is
+ * drawn from stream i of mc_seed, so that the estimate after a given number of samples is the same
+ * however the point-checks were spread over the simulators.
+ *
+ * With mc_method "importance", the samples are drawn instead from a mixture about the boundary
+ * points of the margins, and each failure counts by its likelihood ratio. The estimate is unbiased
+ * for any proposal; this one puts about half of its samples in the failure region.
+ *
+ * With mc_method "directional", each sample is instead a boundary search along a direction of a
+ * scrambled Sobol sequence on the sphere, and counts for the probability beyond its margin. */
+int monte_carlo(Configuration *C)
+{
+  int all_good = 1;
+  McRound R = {.C = C, .next_report = 16};
+  Proposal P = {0};
+
+  /* initialize */
+  Space *S = malloc(C->num_params_all * sizeof *S);  // mem:ravelins
+  if (!initspace(C, S)) {
+    free(S);  // mem:ravelins
+    return 0;
+  }
+  makeiter(C, 'M');
+  pname(C);
+
+  int slots = C->options.max_subprocesses > 0 ? C->options.max_subprocesses
+                                               : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  /* enough to keep every slot busy, at every corner */
+  int round = 16 * slots / corners_per_search(C);
+  if (round < 1)
+    round = 1;
+  double *pc = malloc(round * (N + K) * sizeof *pc);  // mem:colonitis
+  double *z = malloc((N + 1) * sizeof *z);            // mem:woodshock
+  double *x = malloc((N > 0 ? N : 1) * sizeof *x);    // mem:cowslip
+  double *dirs = malloc(round * N * sizeof *dirs);    // mem:stagily
+  R.searches = malloc(round * sizeof *R.searches);    // mem:unmewed
+  R.sample = malloc(round * sizeof *R.sample);        // mem:ribaldly
+  R.fail = malloc(round * sizeof *R.fail);            // mem:tarpans
+  R.ratio = malloc(round * sizeof *R.ratio);          // mem:gadroon
+
+  /* Exceptions */
+  if (N == 0) {
+    fprintf(stderr, "No free parameters included. Nothing to do\n");
+    all_good = 0;
+    goto cleanup;
+  }
+  if (C->options.mc_samples < 1) {
+    fprintf(stderr, "[montecarlo] samples = %d: nothing to do\n", C->options.mc_samples);
+    all_good = 0;
+    goto cleanup;
+  }
+  if (C->options.mc_method == IMPORTANCE && !proposal_init(C, S, &P)) {
+    all_good = 0;
+    goto cleanup;
+  }
+  if (C->options.mc_method == DIRECTIONAL) {
+    if (N > 30) {
+      fprintf(stderr, "%d non-corner parameters is greater than the upper limit of 30\n", N);
+      all_good = 0;
+      goto cleanup;
+    }
+    /* check the nominal once, rather than at the start of every search */
+    for (int i = 0; N + K > i; ++i)
+      pc[i] = S[i].centerpnt;
+    R.searches[0] = SEARCH_INIT(pc, NULL, NULL);
+    addpoint_batch(C, S, R.searches, 1, NULL, NULL);
+    if (R.searches[0].margin == 0.0) {
+      fprintf(stderr, "Circuit failed for nominal parameter values\n");
+      all_good = 0;
+      goto cleanup;
+    }
+  }
+
+  lprintf(C, "\nMonte Carlo (%s): up to %d %s x %d corners, seed %d\n",
+          method_names[C->options.mc_method], C->options.mc_samples,
+          C->options.mc_method == DIRECTIONAL ? "directions" : "samples", corners_per_search(C),
+          C->options.mc_seed);
+  if (C->options.mc_method == DIRECTIONAL)
+    lprintf(C, " Vectors             1-Yield    95%% confidence\n");
+  else
+    lprintf(C, " Samples  Failures   1-Yield    95%% confidence\n");
+  while (!R.stop && R.samples < C->options.mc_samples) {
+    if (!checkiter(C))
+      break;
+    int num = round;
+    if (num > C->options.mc_samples - R.samples)
+      num = C->options.mc_samples - R.samples;
+    num = budget_fits(C, num);
+    if (num == 0) {
+      budget_allows(C, 1);
+      break;
+    }
+    /* draw the round */
+    int num_searches = 0;
+    if (C->options.mc_method == DIRECTIONAL) {
+      for (int s = 0; num > s; ++s) {
+        /* point 0 of the sequence is its shift alone: start at 1 */
+        sobol_direction((uint64_t)C->options.mc_seed, (uint32_t)(R.samples + s + 1), z, N);
+        for (int i = 0; N > i; ++i)
+          dirs[s * N + i] = -z[i];  // direction is negative-wise
+        R.fail[s] = -1;
+        R.sample[num_searches] = s;
+        R.searches[num_searches] = SEARCH_INIT(pc, &dirs[s * N], NULL);
+        R.searches[num_searches++].skip_center = 1;
+      }
+    } else {
+      /* samples out of the parameter ranges fail without a simulation */
+      for (int s = 0; num > s; ++s) {
+        double *p = &pc[s * (N + K)];
+        counter_gauss((uint64_t)C->options.mc_seed, (uint64_t)(R.samples + s), z,
+                      C->options.mc_method == IMPORTANCE ? N + 1 : N);
+        R.ratio[s] = C->options.mc_method == IMPORTANCE ? proposal_draw(C, &P, z, x) : 1.0;
+        for (int i = 0; N > i; ++i)
+          p[i] = S[i].centerpnt + (C->options.mc_method == IMPORTANCE ? x[i] : z[i]);
+        for (int i = N; N + K > i; ++i)
+          p[i] = S[i].centerpnt;
+        int in_range = in_bounds(p, C);
+        R.fail[s] = in_range ? -1 : 1;
+        if (in_range) {
+          R.sample[num_searches] = s;
+          R.searches[num_searches++] = SEARCH_INIT(p, NULL, NULL);
+        }
+      }
+    }
+    R.num = num;
+    R.num_searches = num_searches;
+    R.counted = 0;
+    mc_count(&R);
+    if (!R.stop)
+      addpoint_batch(C, S, R.searches, num_searches, mc_done, &R);
+  }
+
+  if (R.samples == 0) {
+    lprintf(C, "\nNo samples were checked\n");
+  } else {
+    double lo, hi, p = mc_interval(C, &R, &lo, &hi);
+    if (R.samples != R.next_report / 2)
+      mc_line(C, &R);
+    if (C->options.mc_method == DIRECTIONAL)
+      lprintf(C, "\n1-Yield: %.3e, 95%% confidence %.3e to %.3e (%ld directions)\n", p, lo, hi,
+              R.samples);
+    else
+      lprintf(C, "\n1-Yield: %.3e, 95%% confidence %.3e to %.3e (%ld of %ld samples failed)\n", p,
+              lo, hi, R.fails, R.samples);
+    if (C->options.mc_method != PLAIN && hi > p && p > 0.0) {
+      /* plain sampling needs p(1-p)/se^2 samples for the same standard error */
+      double se = (hi - p) / 1.96;
+      lprintf(C, "Standard error %.2e: plain sampling would need about %.2g samples\n", se,
+              p * (1.0 - p) / (se * se));
+    }
+    if (R.stop)
+      lprintf(C, "The confidence interval is within %g%% of 1-Yield\n", C->options.mc_confidence);
+  }
+  budget_report(C);
+
+  /* remove temp files */
+cleanup:
+  unlink(C->file_names.iter);
+  unlink_pname(C);
+  proposal_free(&P);
+  free(R.ratio);     // mem:gadroon
+  free(R.fail);      // mem:tarpans
+  free(R.sample);    // mem:ribaldly
+  free(R.searches);  // mem:unmewed
+  free(dirs);        // mem:stagily
+  free(x);           // mem:cowslip
+  free(z);           // mem:woodshock
+  free(pc);          // mem:colonitis
+  free(S);           // mem:ravelins
+  return all_good;
+}
@@ -0,0 +1,11 @@
+// vi: ts=2 sts=2 sw=2 et tw=100
+
+#ifndef MONTECARLO
+#define MONTECARLO
+
+// typedef struct config Configuration;
+#include "config.h"
+
+int monte_carlo(Configuration *);
+
+#endif
@@ -1,5 +1,6 @@
 // vi: ts=2 sts=2 sw=2 et tw=100
 /* For the numerical recipes routines */
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -74,3 +75,71 @@ void free_matrix(double **m, int nrl, int nrh, int ncl, int nch)
   }
   free(m + nrl);  // mem:unsurmountableness
 }
+
+/* Diagonalizes the symmetric n by n matrix a[i * n + j] by cyclic Jacobi rotations, destroying it.
+ * The eigenvalues are left in val[..] in decreasing order, and the eigenvector of val[j] in the
+ * column vec[i * n + j], its largest element positive. */
+void symmetric_eigen(int n, double *a, double *val, double *vec)
+{
+  for (int i = 0; n > i; ++i)
+    for (int j = 0; n > j; ++j)
+      vec[i * n + j] = (i == j) ? 1.0 : 0.0;
+  for (int sweep = 0; 64 > sweep; ++sweep) {
+    double off = 0.0, diag = 0.0;
+    for (int p = 0; n > p; ++p) {
+      diag += a[p * n + p] * a[p * n + p];
+      for (int q = p + 1; n > q; ++q)
+        off += a[p * n + q] * a[p * n + q];
+    }
+    if (off <= 1e-30 * diag)
+      break;
+    for (int p = 0; n > p; ++p) {
+      for (int q = p + 1; n > q; ++q) {
+        if (a[p * n + q] == 0.0)
+          continue;
+        /* the rotation that zeroes a[p][q] */
+        double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * a[p * n + q]);
+        double t = ((theta < 0.0) ? -1.0 : 1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+        double c = 1.0 / sqrt(t * t + 1.0), s = t * c;
+        for (int k = 0; n > k; ++k) {
+          double kp = a[k * n + p], kq = a[k * n + q];
+          a[k * n + p] = c * kp - s * kq;
+          a[k * n + q] = s * kp + c * kq;
+        }
+        for (int k = 0; n > k; ++k) {
+          double pk = a[p * n + k], qk = a[q * n + k];
+          a[p * n + k] = c * pk - s * qk;
+          a[q * n + k] = s * pk + c * qk;
+        }
+        for (int k = 0; n > k; ++k) {
+          double kp = vec[k * n + p], kq = vec[k * n + q];
+          vec[k * n + p] = c * kp - s * kq;
+          vec[k * n + q] = s * kp + c * kq;
+        }
+      }
+    }
+  }
+  for (int j = 0; n > j; ++j)
+    val[j] = a[j * n + j];
+  /* sort by eigenvalue, and fix the signs */
+  for (int j = 0; n > j; ++j) {
+    int big = j;
+    for (int k = j + 1; n > k; ++k)
+      if (val[k] > val[big])
+        big = k;
+    double swap = val[j];
+    val[j] = val[big];
+    val[big] = swap;
+    int top = 0;
+    for (int i = 0; n > i; ++i) {
+      swap = vec[i * n + j];
+      vec[i * n + j] = vec[i * n + big];
+      vec[i * n + big] = swap;
+      if (fabs(vec[i * n + j]) > fabs(vec[top * n + j]))
+        top = i;
+    }
+    if (vec[top * n + j] < 0.0)
+      for (int i = 0; n > i; ++i)
+        vec[i * n + j] = -vec[i * n + j];
+  }
+}
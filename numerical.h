@@ -9,5 +9,6 @@ extern double **matrix(int nrl, int nrh, int ncl, int nch);
 extern void free_ivector(int *v, int nl, int nh);
 extern void free_vector(double *v, int nl, int nh);
 extern void free_matrix(double **m, int nrl, int nrh, int ncl, int nch);
+void symmetric_eigen(int n, double *a, double *val, double *vec);
 
 #endif
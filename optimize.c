@@ -8,6 +8,7 @@
 #include "space.h"
 #include "stat_math.h"
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -15,25 +16,214 @@
 
 #define N (C->num_params)
 
+/* directions of the hull yield per block: the sums of a block are kept apart and added up in block
+ * order, so the estimate is the same to the bit for any number of threads */
+#define HULL_BLOCK 1024
+/* directions taken through the planes together, in the innermost loops, where they vectorize */
+#define HULL_LANES 8
+/* the scrambling of the directions, fixed so that the estimate is the same from run to run */
+#define HULL_SEED 1
+
+/* A pass of the hull yield: the unit normals of the planes in `a[plane*dim..]`, packed, and their
+ * distances from the center in `d[..]`. */
+typedef struct hull_pass {
+  int dim, num_planes, num_dirs, num_threads;
+  const double *a, *d;
+  double *sums;  // per block: the sum of the gauss tails, and of their squares
+} HullPass;
+
+typedef struct hull_work {
+  HullPass *P;
+  int id;
+} HullWork;
+
+/* One thread of a hull pass. From the center, the boundary of the hull along the unit vector u is
+ * at the nearest of d[i] / -(a[i].u) over the planes that face away from u, and the gauss integral
+ * beyond it is exact: only the directions are sampled. */
+static void *hull_blocks(void *arg)
+{
+  HullWork *W = arg;
+  HullPass *P = W->P;
+  int dim = P->dim, blocks = (P->num_dirs + HULL_BLOCK - 1) / HULL_BLOCK;
+  double *u = malloc(dim * HULL_LANES * sizeof *u);  // mem:pleonasms
+  double *v = malloc(dim * sizeof *v);               // mem:frowsty
+  double dot[HULL_LANES], t[HULL_LANES];
+
+  for (int blk = W->id; blocks > blk; blk += P->num_threads) {
+    double *sum = &P->sums[2 * blk];
+    int end = (blk + 1) * HULL_BLOCK < P->num_dirs ? (blk + 1) * HULL_BLOCK : P->num_dirs;
+    sum[0] = sum[1] = 0.0;
+    for (int s = blk * HULL_BLOCK; end > s; s += HULL_LANES) {
+      int lanes = end - s < HULL_LANES ? end - s : HULL_LANES;
+      for (int l = 0; HULL_LANES > l; ++l) {
+        if (lanes > l)
+          sobol_direction(HULL_SEED, (uint32_t)(s + l + 1), v, dim);
+        for (int k = 0; dim > k; ++k)
+          u[k * HULL_LANES + l] = (lanes > l) ? v[k] : 0.0;
+        t[l] = INFINITY;
+      }
+      for (int i = 0; P->num_planes > i; ++i) {
+        const double *ai = &P->a[i * dim];
+        for (int l = 0; HULL_LANES > l; ++l)
+          dot[l] = 0.0;
+        for (int k = 0; dim > k; ++k)
+          for (int l = 0; HULL_LANES > l; ++l)
+            dot[l] += ai[k] * u[k * HULL_LANES + l];
+        for (int l = 0; HULL_LANES > l; ++l) {
+          double r = (dot[l] < 0.0) ? -P->d[i] / dot[l] : INFINITY;
+          t[l] = (r < t[l]) ? r : t[l];
+        }
+      }
+      for (int l = 0; lanes > l; ++l) {
+        double q = isinf(t[l]) ? 0.0 : gauss_integral_c(t[l], dim);
+        sum[0] += q;
+        sum[1] += q * q;
+      }
+    }
+  }
+  free(u);  // mem:pleonasms
+  free(v);  // mem:frowsty
+  return NULL;
+}
+
+/* Estimates 1-Yield of the hull of `plncount` planes about the center S[..].centerpnt, without a
+ * simulation, from o_yield_dirs directions on o_threads threads. Stores the estimate in *q and its
+ * standard error in *se (as if the directions were independent, which overstates it). */
+static void hull_yield(const Configuration *C, const Space *S, Plane **plane, int plncount,
+                       double *q, double *se)
+{
+  int num = C->options.o_yield_dirs;
+  int blocks = (num + HULL_BLOCK - 1) / HULL_BLOCK;
+  int num_work = C->options.o_threads > 0 ? C->options.o_threads
+                                          : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  double *a = malloc(plncount * N * sizeof *a);  // mem:ungladden
+  double *d = malloc(plncount * sizeof *d);      // mem:snaggletooth
+  HullPass P = {N, plncount, num, 0, a, d, NULL};
+
+  if (num_work < 1)
+    num_work = 1;
+  P.num_threads = num_work < blocks ? num_work : blocks;
+  for (int i = 0; plncount > i; ++i) {
+    d[i] = plane[i]->b;
+    for (int k = 0; N > k; ++k) {
+      a[i * N + k] = plane[i]->a[k];
+      d[i] += plane[i]->a[k] * S[k].centerpnt;
+    }
+  }
+  P.sums = malloc(2 * blocks * sizeof *P.sums);                // mem:hogwash
+  HullWork *W = malloc(P.num_threads * sizeof *W);             // mem:brabble
+  pthread_t *thread = malloc(P.num_threads * sizeof *thread);  // mem:cantle
+  for (int i = 0; P.num_threads > i; ++i)
+    W[i] = (HullWork){&P, i};
+  /* this thread takes the first share, and any that a thread could not be started for */
+  int started = 1;
+  while (P.num_threads > started &&
+         pthread_create(&thread[started], NULL, hull_blocks, &W[started]) == 0)
+    ++started;
+  hull_blocks(&W[0]);
+  for (int i = started; P.num_threads > i; ++i)
+    hull_blocks(&W[i]);
+  for (int i = 1; started > i; ++i)
+    pthread_join(thread[i], NULL);
+
+  double sum = 0.0, sum2 = 0.0;
+  for (int blk = 0; blocks > blk; ++blk) {
+    sum += P.sums[2 * blk];
+    sum2 += P.sums[2 * blk + 1];
+  }
+  *q = sum / num;
+  *se = (num > 1 && sum2 > sum * *q) ? sqrt((sum2 - sum * *q) / (num - 1) / num) : 0.0;
+  free(thread);  // mem:cantle
+  free(W);       // mem:brabble
+  free(P.sums);  // mem:hogwash
+  free(d);       // mem:snaggletooth
+  free(a);       // mem:ungladden
+}
+
+/* Grows the accuracies of the margin points along with margpnts, to `num`. */
+static double *acc_grow(double *acc, int num)
+{
+  return realloc(acc, num * sizeof *acc);  // mem:outbargain
+}
+
+/* Prints 1-Yield of the final hull, and, if o_nom_step is set, how it changes as each nom_min or
+ * nom_max that holds the center back moves by that much, the center inscribed again each time.
+ * The center and the tangent planes of the optimization are left as they were. */
+static void hull_report(Configuration *C, Space *S, Plane **plane, int plncount, double radius)
+{
+  double q, se, held_q, r;
+
+  hull_yield(C, S, plane, plncount, &held_q, &se);
+  lprintf(C,
+          "\nYield of the hull, %d directions from the center (no simulations)\n"
+          "1-Yield %.2e +/- %.2e, the inscribed hypersphere alone %.2e\n",
+          C->options.o_yield_dirs, held_q, se, gauss_integral_c(radius, N));
+  if (C->options.o_nom_step <= 0.0)
+    return;
+
+  double *was = malloc(N * sizeof *was);       // mem:tressed
+  int *tang = malloc((N + 1) * sizeof *tang);  // mem:sennight
+  int header = 0;
+  for (int i = 0; N > i; ++i)
+    was[i] = S[i].centerpnt;
+  for (int i = 0; N > i; ++i) {
+    double *bound = NULL;
+    if (!(C->params[i].nom_min < was[i]))
+      bound = &C->params[i].nom_min;
+    else if (!(C->params[i].nom_max > was[i]))
+      bound = &C->params[i].nom_max;
+    if (bound == NULL)
+      continue;
+    if (!header) {
+      lprintf(C,
+              "\n1-Yield of the hull as each binding constraint moves by %g sigma\n"
+              "Parameter                Bound          Lower       Held     Higher\n",
+              C->options.o_nom_step);
+      header = 1;
+    }
+    lprintf(C, "%3d) %-19.19s %-7s  ", i + 1, C->params[i].name,
+            (bound == &C->params[i].nom_min) ? "nom_min" : "nom_max");
+    double held = *bound;
+    for (int j = -1; 1 >= j; ++j) {
+      *bound = held + j * C->options.o_nom_step;
+      if (j == 0) {
+        lprintf(C, "   %.2e", held_q);
+      } else if (center(C, S, plane, tang, plncount, &r)) {
+        hull_yield(C, S, plane, plncount, &q, &se);
+        lprintf(C, "   %.2e", q);
+      } else {
+        lprintf(C, "   %8s", "-");
+      }
+    }
+    lprintf(C, "\n");
+    *bound = held;
+    for (int k = 0; N > k; ++k)
+      S[k].centerpnt = was[k];
+  }
+  free(was);   // mem:tressed
+  free(tang);  // mem:sennight
+}
+
 static int optimize(Configuration *C, Space *S, const double *prhi, const double *prlo)
 {
   Plane **plane = NULL;
   double **margpnts = NULL;
   double *facecenter, *vect;
   int *tang;
-  short *pntstack;
+  vertex_t *pntstack;
   int plncount = 0, plnmemory = 0, pntmemory = 0, pntcount = 0;
   int pinc, minc;
-  int stop = 0, iterate = 0, max_iterate, max_plncount, pc_bytes;
+  int stop = 0, over_budget = 0, iterate = 0, max_iterate, max_plncount, pc_bytes;
   int tangent;
-  double radius, dum, dum2;
+  double radius, dum, dum2, grown = -1.0;
   int flag, flag2 = 0;
   double radiushi, radiuslo;
   int i, j, k;
-  int big, oldcount = 0, lowcount = 0;
+  int big;
   int match, ii;
   int all_good = 1;
-  double *improve;
+  int window = 0, refined;
+  double *improve, *margacc;
   double *pc = malloc((N + C->num_params_corn) * sizeof *pc);  // mem:unwomanish
   double *direction = malloc(N * sizeof *direction);           // mem:bergs
   double *pr = malloc(N * sizeof *pr);
@@ -59,7 +249,7 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
   lprintf(C,
           "\nOptimization in %d dimensions with %d corners"
           "\nPoints Simplexes M(Sigma)   Parameter_Values\n",
-          N, 1 << C->num_params_corn);
+          N, corners_per_search(C));
 
   /* Exit criteria things */
   /* limit memory to a 32GiByte */
@@ -67,13 +257,19 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
     C->options.y_max_mem_k = 33554432;
   /* translate max_mem into max_plncount */
   /* plncount memory budget */
-  // Plane:         (short)flag=2, (short)points=2*N, double(b)=8, *a=8, double a[]=8*N
+  // Plane:         (short)flag=2, (vertex_t)points=4*N, (int)adj=4*N, double(b)=8, *a=8,
+  //                double a[]=8*N
   // center matrix: (int)vector=8, (double)matrix=(N+3)*8
-  pc_bytes = 2 + 8 + 8 + 8 + (2 + 8) * N + 8 * (N + 3);
-  /* bytes per simplex: (double)mean=8, (double)powm=8, (short)t=N*2 */
+  pc_bytes = 2 + 8 + 8 + 8 + (4 + 4 + 8) * N + 8 * (N + 3);
   max_plncount = (int)(((long)C->options.y_max_mem_k * 1024) /
                        (long)pc_bytes);  // fits within a [signed] int, which is plenty
-  max_iterate = 32767;  // because pntstack is of type [signed] short, which is plenty
+  max_iterate = 1 << 28;                 // far more than the planes could take
+  /* the first hull has a plane for every one of the 2^N quadrants */
+  if ((1L << N) > max_plncount) {
+    fprintf(stderr, "The %ld planes of the first hull need more than max_mem_k = %d [KiB]\n",
+            1L << N, C->options.y_max_mem_k);
+    return 0;
+  }
 
   /* memory allocation */
   tang = malloc((N + 1) * sizeof *tang);                        // mem:quiets
@@ -89,6 +285,7 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
   }
   minc = 2 * N + 100;
   margpnts = margpnts_malloc(margpnts, &pntmemory, minc, N);  // mem:crystallic
+  margacc = acc_grow(NULL, pntmemory);
   /* initialize */
 
   /* store margins */
@@ -100,7 +297,11 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
     }
     margpnts[2 * i][i] = prlo[i];
     margpnts[2 * i + 1][i] = prhi[i];
+    margacc[2 * i] = margacc[2 * i + 1] = C->accuracy;
   }
+  /* start with a coarse binary search, if so configured */
+  if (C->options.o_binsearch_start > C->options.binsearch_accuracy)
+    C->accuracy = C->options.o_binsearch_start;
   /* pick initial combination of C->num_params*2 points and make the hull */
   intpickpnts(pntstack, C, S, 0, plane, margpnts, &plncount, pntcount);
   /*   lprintf(C, "simplex elements: %i total\n\n",plncount); */
@@ -112,7 +313,7 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
       all_good = 0;
       goto cleanup;
     }
-    if ((big = findface(N, facecenter, plane, tang, plncount, tangent)) == -1) {
+    if ((big = findface(N, facecenter, plane, tang, tangent)) == -1) {
       lprintf(C, "Simplex cannot inflate further: optimization complete\n");
       stop = 1;
     }
@@ -141,7 +342,6 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
         lprintf(C, "warning: Param '%s' limited by the binary search '%s'\n", C->params[i - 1].name,
                 flag2 ? "max" : "min");
       } else {
-        lowcount = oldcount = plncount;
         /* addpoint_corners needs to know the center (C->params[i].pc) */
         /*                  and the search direction (C->params[i].direction) */
         for (i = 0; N > i; ++i) {
@@ -149,9 +349,11 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
           direction[i] = plane[big]->a[i];
         }
         /* make sure there's room to store the new point */
-        if (pntcount + 1 >= pntmemory)
+        if (pntcount + 1 >= pntmemory) {
           margpnts = margpnts_malloc(margpnts, &pntmemory, C->num_params * 2,
                                      C->num_params);  // mem:crystallic
+          margacc = acc_grow(margacc, pntmemory);
+        }
         /* flag plane if not convex */
         if (addpoint_corners(C, S, NULL, margpnts[pntcount], pc, direction) == 0.0) {
           plane[big]->flag = 1;
@@ -162,70 +364,10 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
           lprintf(C, "\n\n");
         } else {
           /* store the new point */
+          margacc[pntcount] = C->accuracy;
           ++pntcount;
-          /* flag planes the new point is exterior to */
-          for (j = 0; oldcount > j; ++j) {
-            for (i = 0, dum = plane[j]->b; N > i; ++i) {
-              dum += plane[j]->a[i] * margpnts[pntcount - 1][i];
-            }
-            if (dum < 0.0) {
-              plane[j]->flag = 2;
-              --lowcount;
-            }
-          }
-          /* find new planes, using new point and old-plane-point combinations */
-          for (k = 0; oldcount > k; ++k) {
-            if (plane[k]->flag == 2) {
-              for (i = 0; i < N; ++i) {
-                for (j = 0; j < N; ++j) {
-                  pntstack[j] = plane[k]->points[j];
-                }
-                pntstack[i] = pntcount - 1;
-                /* allocate more planes in memory */
-                if (plncount == plnmemory) {
-                  pinc = plncount / 3 + 1;  // 30% more everytime
-                  if ((plane = plane_malloc(plane, &plnmemory, pinc, N)) ==
-                      NULL) {  // mem:nucivorous
-                    perror("No more memory\n");
-                    exit(EXIT_FAILURE);
-                  }
-                }
-                makeaplane(pntstack, C, S, plane, margpnts, &plncount, pntcount);
-              }
-            }
-          }
-          /* flag duplicate planes (good e.g. if the operating region has a planar surface) */
-          /* pick a plane */
-          for (k = oldcount; plncount - 1 > k; ++k) {
-            /* pick another plane */
-            for (j = k + 1; plncount > j; ++j) {
-              /* pick a point of the first plane */
-              for (i = 0, match = 1; N > i && match; ++i) {
-                /* does the point exist on the other plane? */
-                for (ii = 0, match = 0; N > ii && !match; ++ii) {
-                  match = (plane[k]->points[i] == plane[j]->points[ii]);
-                }
-              }
-              if (match == 1) {
-                plane[k]->flag = 2;
-                /* printf("ODD: Duplicate planes were created!!\n"); */
-              }
-            }
-          }
-          /* delete old planes */
-          /* now new planes may be flagged too */
-          for (j = 0; plncount > j;) {
-            if (plane[j]->flag == 2) {
-              --plncount;
-              plane[j]->b = plane[plncount]->b;
-              plane[j]->flag = plane[plncount]->flag;
-              for (i = 0; N > i; ++i) {
-                plane[j]->a[i] = plane[plncount]->a[i];
-                plane[j]->points[i] = plane[plncount]->points[i];
-              }
-            } else
-              ++j;
-          }
+          /* replace the planes the new point is beyond */
+          hull_add(C, S, &plane, &plnmemory, &plncount, margpnts, pntcount - 1, big);
         }
       }
     }
@@ -249,14 +391,30 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
     if (!stop && !checkiter(C)) {
       stop = 1;
     }
+    /* the next search would not fit in the simulation budget */
+    if (!stop && !budget_allows(C, 1)) {
+      stop = over_budget = 1;
+      grown = (iterate > C->options.o_min_iter) ? radius - improve[iterate % C->options.o_min_iter]
+                                                : radius;
+      lprintf(C, "\nOptimization Interrupted\n\n");
+    }
     /* radius increasing slowly */
-    if (!stop && (iterate > C->options.o_min_iter)) {
-      if ((radius - improve[iterate % C->options.o_min_iter]) < C->options.binsearch_accuracy) {
-        stop = 1;
-        lprintf(C,
-                "Margin has increased less than binsearch_accuracy=%.3f in the last o_min_iter=%d "
-                "iterations:\nOptimization interrupted\n",
-                C->options.binsearch_accuracy, C->options.o_min_iter);
+    if (!stop && (iterate - window > C->options.o_min_iter)) {
+      if ((radius - improve[iterate % C->options.o_min_iter]) < C->accuracy) {
+        if (C->accuracy > C->options.binsearch_accuracy) {
+          /* tighten the binary search and start a new window */
+          C->accuracy /= 2.0;
+          if (C->accuracy < C->options.binsearch_accuracy)
+            C->accuracy = C->options.binsearch_accuracy;
+          window = iterate;
+          lprintf(C, "Margin has converged: binsearch accuracy tightened to %.3f\n", C->accuracy);
+        } else {
+          stop = 1;
+          lprintf(C,
+                  "Margin has increased less than binsearch_accuracy=%.3f in the last "
+                  "o_min_iter=%d iterations:\nOptimization interrupted\n",
+                  C->options.binsearch_accuracy, C->options.o_min_iter);
+        }
       }
     }
     improve[iterate % C->options.o_min_iter] = radius;
@@ -273,11 +431,61 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
 
   } while (!stop);
   /* end loop */
-  /* inscribe one more time */
-  if (!(tangent = center(C, S, plane, tang, plncount, &radius))) {
-    fprintf(stderr, "malt: Numerical error in routine center\n");
-    all_good = 0;
-    goto cleanup;
+  /* inscribe one more time, refining the coarse points that the hypersphere actually touches */
+  C->accuracy = C->options.binsearch_accuracy;
+  do {
+    if (!(tangent = center(C, S, plane, tang, plncount, &radius))) {
+      fprintf(stderr, "malt: Numerical error in routine center\n");
+      all_good = 0;
+      goto cleanup;
+    }
+    refined = 0;
+    for (j = 0; tangent > j; ++j) {
+      for (k = 0; N > k; ++k) {
+        ii = plane[tang[j]]->points[k];
+        if (margacc[ii] <= C->accuracy || over_budget)
+          continue;
+        if (!budget_allows(C, 1)) {
+          over_budget = 1;
+          continue;
+        }
+        /* search again from the center towards the coarse point */
+        for (i = 0; N > i; ++i) {
+          pc[i] = S[i].centerpnt;
+          direction[i] = S[i].centerpnt - margpnts[ii][i];
+        }
+        for (i = 0, dum = 0.0; N > i; ++i)
+          dum += direction[i] * direction[i];
+        for (i = 0, dum = sqrt(dum); N > i; ++i)
+          direction[i] /= dum;
+        if (addpoint_corners(C, S, NULL, pr, pc, direction) != 0.0) {
+          for (i = 0; N > i; ++i)
+            margpnts[ii][i] = pr[i];
+        }
+        margacc[ii] = -1.0;  // moved in this pass
+        ++refined;
+      }
+    }
+    /* planes through points that moved must be recalculated */
+    for (j = 0; refined && plncount > j; ++j) {
+      for (k = 0, match = 0; N > k; ++k)
+        match |= (margacc[plane[j]->points[k]] < 0.0);
+      if (match)
+        replane(C, S, plane[j], margpnts);
+    }
+    for (i = 0; pntcount > i; ++i)
+      if (margacc[i] < 0.0)
+        margacc[i] = C->accuracy;
+    if (refined)
+      lprintf(C, "Refined %d coarse points on the inscribed hypersphere\n", refined);
+  } while (refined);
+  if (over_budget) {
+    /* the radius is only as good as it got: say how good */
+    lprintf(C, "Stopped at radius %.2f sigma, binsearch accuracy %.3f", radius, C->accuracy);
+    if (grown >= 0.0)
+      lprintf(C, ", grown %.3f in the last %d iterations", grown,
+              (iterate > C->options.o_min_iter) ? C->options.o_min_iter : iterate);
+    lprintf(C, "\n");
   }
   /* calculate criticalness */
   for (i = 0; N > i; ++i) {
@@ -290,7 +498,14 @@ static int optimize(Configuration *C, Space *S, const double *prhi, const double
 
   /* some diagnostics */
   lprintf(C, "\nMemory Used (kB): %ld\n", ((long)plncount * (long)pc_bytes) / 1024 + 1);  // go long
+  /* the yield of the hull as it stands */
+  if (C->options.o_yield_dirs > 0)
+    hull_report(C, S, plane, plncount, radius);
   /* convexity check along critical vectors */
+  if (!budget_allows(C, tangent)) {
+    lprintf(C, "\nConvexity check skipped: out of simulation budget\n");
+    goto cleanup;
+  }
   lprintf(C, "\nConvexity: The distance ratio (simplex/ellipsoid) should be unity or greater"
              "\n                 Ratio:   Parameter_Values\n");
   for (j = 0; tangent > j; ++j) {
@@ -321,6 +536,7 @@ cleanup:
   free(vect);                          // mem:isostere
   free(pntstack);                      // mem:diaheliotropically
   free(improve);                       // mem:knackwursts
+  free(margacc);                       // mem:outbargain
   plane_free(plane, plnmemory);        // mem:nucivorous
   margpnts_free(margpnts, pntmemory);  // mem:crystallic
   free(pc);                            // mem:unwomanish
@@ -343,8 +559,8 @@ int call_opt(Configuration *C)
   double *prhi = malloc(C->num_params * sizeof *prhi);
   double *prlo = malloc(C->num_params * sizeof *prlo);
   /* Exceptions */
-  if (N > 10) {
-    fprintf(stderr, "%d non-corner parameters is greater than the 10 allowed.\n", N);
+  if (N > 30) {
+    fprintf(stderr, "%d non-corner parameters is greater than the 30 allowed.\n", N);
     all_good = 0;
     goto cleanup;
   }
@@ -353,16 +569,25 @@ int call_opt(Configuration *C)
     all_good = 0;
     goto cleanup;
   }
+  /* and fewer parameters to optimize */
+  if (C->options.o_screen > 0.0 &&
+      !screen(C, S, prhi, prlo, C->options.o_screen, C->options.o_screen_dirs)) {
+    all_good = 0;
+    goto cleanup;
+  }
   /* optimize */
   if (!optimize(C, S, prhi, prlo)) {
     all_good = 0;
     goto cleanup;
   }
   /* margins again at the end */
-  if (!margins(C, S, prhi, prlo)) {
+  if (!budget_allows(C, 2 * N)) {
+    lprintf(C, "\nFinal margins skipped: out of simulation budget\n");
+  } else if (!margins(C, S, prhi, prlo)) {
     all_good = 0;
     goto cleanup;
   }
+  budget_report(C);
   /* clean up temporary files */
 cleanup:
   free(prhi);
@@ -27,6 +27,47 @@ double physspace(double a, const Configuration *C, int i)
   return a;
 }
 
+/* The analysis runs in the space of the included parameters, in which the correlated ones are
+ * replaced by their principal components (C->num_components, the last of the num_params normal
+ * ones). The parameters that follow the components are linear in it, in malt space. */
+
+/* How far parameter i moves in malt space along the step d[0..num_params] of the analysis. */
+double malt_along(const double *d, const Configuration *C, int i)
+{
+  if (C->num_params > i)
+    return d[i];
+  if (!C->params[i].load)
+    return 0.0;
+  const double *u = &d[C->num_params - C->num_components];
+  double a = 0.0;
+  for (int j = 0; C->num_components > j; ++j)
+    a += C->params[i].load[j] * u[j];
+  return a;
+}
+
+/* The malt space value of parameter i at the point p[0..num_params+num_params_corn] of the
+ * analysis. */
+double malt_at(const double *p, const Configuration *C, int i)
+{
+  if (C->num_params + C->num_params_corn > i)
+    return p[i];
+  /* the components are 0 at the nominal point */
+  return maltspace(C->params[i].nominal, C, i) + malt_along(p, C, i);
+}
+
+/* Is the point p of the analysis within the min and max of every parameter that it moves? */
+int in_bounds(const double *p, const Configuration *C)
+{
+  for (int i = 0; C->num_params_all > i; ++i) {
+    if (C->num_params <= i && !C->params[i].load)
+      continue;
+    double a = malt_at(p, C, i);
+    if (a < C->params[i].min || a > C->params[i].max)
+      return 0;
+  }
+  return 1;
+}
+
 int initspace(Configuration *C, Space *S)
 {
   int i;
@@ -14,6 +14,9 @@ typedef struct space {
 
 double maltspace(double, const Configuration *, int);
 double physspace(double, const Configuration *, int);
+double malt_along(const double *, const Configuration *, int);
+double malt_at(const double *, const Configuration *, int);
+int in_bounds(const double *, const Configuration *);
 int initspace(Configuration *, Space *);
 
 #endif
@@ -2,6 +2,7 @@
 
 #include "stat_math.h"
 #include <math.h>
+#include <stdint.h>
 
 /* all internal functions listed here. the external ones are in the header file */
 double factln(int);
@@ -229,9 +230,215 @@ double gauss_integral(double r, int n)
   return gammp(n / 2.0, r * r / 2.0);
 }
 
+/* Returns Q(n/2, x), the tail of the chi distribution at x = r*r/2, in closed form: the sum of the
+ * terms e^-x x^e/Gamma(e+1) for e = h, h+1, .. below n/2, plus erfc(sqrt(x)) when n is odd, where h
+ * = 0 for even n and 1/2 for odd n.
+ *
+ * Up to the mode the terms are summed upward from the first; past it, downward from the last
+ * (the largest), which is found from `lg_top` = ln Gamma(e+1) of the last term. Either way no term
+ * under- or overflows while the result is representable. */
+static double chi_tail(double x, int n, double lg_top)
+{
+  int num = n / 2;  // terms of the series
+  double h = (n % 2) ? 0.5 : 0.0, term, sum = 0.0;
+
+  if (x <= num) {
+    term = (n % 2) ? 2.0 * exp(-x) * sqrt(x / M_PI) : exp(-x);
+    for (int j = 0; num > j; ++j) {
+      sum += term;
+      term *= x / (j + h + 1.0);
+    }
+  } else if (num > 0) {
+    term = exp(-x + (num - 1 + h) * log(x) - lg_top);
+    for (int j = num - 1; 0 <= j; --j) {
+      sum += term;
+      term *= (j + h) / x;
+    }
+  }
+  return (n % 2) ? sum + erfc(sqrt(x)) : sum;
+}
+
+/* Returns ln Gamma(e+1) of the last term of chi_tail. */
+static double chi_tail_top(int n)
+{
+  return n > 1 ? lgamma(n / 2 - 1 + ((n % 2) ? 0.5 : 0.0) + 1.0) : 0.0;
+}
+
 double gauss_integral_c(double r, int n)
 /* Returns the value of the complementary n-dimensional gaussian integral. */
-/* i.e., 1-gauss_integral */ { return gammq(n / 2.0, r * r / 2.0); }
+/* i.e., 1-gauss_integral */
+{
+  double x = r * r / 2.0;
+  return chi_tail(x, n, x > n / 2 ? chi_tail_top(n) : 0.0);
+}
+
+void gauss_integral_c_batch(const double *r, double *q, int num, int n)
+/* Stores gauss_integral_c(r[i], n) in q[i] for i = 0..num-1. q may be r. */
+{
+  double lg_top = chi_tail_top(n);
+
+  for (int i = 0; num > i; ++i)
+    q[i] = chi_tail(r[i] * r[i] / 2.0, n, lg_top);
+}
+
+/* Philox4x32-10 (Salmon et al., SC'11): a bijection of the 128-bit counter `ctr` keyed by `key`,
+ * which passes as random. Unlike uniform_deviate it keeps no state, so any number of streams can
+ * draw from it at once, in any order, and get the same numbers every time. */
+static void philox4x32(const uint32_t key[2], const uint32_t ctr[4], uint32_t out[4])
+{
+  uint32_t k0 = key[0], k1 = key[1], x0 = ctr[0], x1 = ctr[1], x2 = ctr[2], x3 = ctr[3];
+
+  for (int round = 0; 10 > round; ++round) {
+    uint64_t p0 = (uint64_t)0xD2511F53 * x0, p1 = (uint64_t)0xCD9E8D57 * x2;
+    uint32_t y0 = (uint32_t)(p1 >> 32) ^ x1 ^ k0, y2 = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+    x1 = (uint32_t)p1;
+    x3 = (uint32_t)p0;
+    x0 = y0;
+    x2 = y2;
+    k0 += 0x9E3779B9;
+    k1 += 0xBB67AE85;
+  }
+  out[0] = x0;
+  out[1] = x1;
+  out[2] = x2;
+  out[3] = x3;
+}
+
+void counter_gauss(uint64_t seed, uint64_t stream, double *z, int n)
+/* Stores n normal deviates (zero mean, unit variance) in z[0..n-1]: the first n of stream `stream`
+ * of seed `seed`, by the Box-Muller transform of counter-based uniform deviates. */
+{
+  const uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+  uint32_t ctr[4] = {0, 0, (uint32_t)stream, (uint32_t)(stream >> 32)}, out[4];
+
+  for (int i = 0; n > i; i += 2, ++ctr[0]) {
+    philox4x32(key, ctr, out);
+    /* 53-bit uniforms, u1 in (0, 1] so that its log is finite */
+    double u1 = ((((uint64_t)out[0] << 32 | out[1]) >> 11) + 1.0) / 9007199254740992.0;
+    double u2 = (((uint64_t)out[2] << 32 | out[3]) >> 11) / 9007199254740992.0;
+    double r = sqrt(-2.0 * log(u1));
+    z[i] = r * cos(2.0 * M_PI * u2);
+    if (n > i + 1)
+      z[i + 1] = r * sin(2.0 * M_PI * u2);
+  }
+}
+
+/* Joe & Kuo's primitive polynomials (degree s, coefficients a) and initial direction numbers m of
+ * the Sobol sequence, for dimensions 2 to SOBOL_DIM. The first dimension is van der Corput's. */
+#define SOBOL_DIM 30
+static const struct {
+  int s, a;
+  uint32_t m[7];
+} sobol_init[SOBOL_DIM - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1, {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4, {1, 3, 7, 13, 13, 15, 69}},
+    {7, 7, {1, 1, 3, 13, 7, 35, 63}},
+    {7, 8, {1, 3, 5, 9, 1, 25, 53}},
+    {7, 14, {1, 3, 1, 13, 9, 35, 107}},
+    {7, 19, {1, 3, 1, 5, 27, 61, 31}},
+    {7, 21, {1, 1, 5, 11, 19, 41, 61}},
+    {7, 28, {1, 3, 5, 3, 3, 13, 69}},
+    {7, 31, {1, 1, 7, 13, 1, 19, 1}},
+    {7, 32, {1, 3, 7, 5, 13, 19, 59}},
+    {7, 37, {1, 1, 3, 9, 25, 29, 41}},
+};
+
+/* Returns the quantile of the standard normal distribution at p, 0 < p < 1: Acklam's rational
+ * approximation, polished by one step of Halley's method. */
+static double gauss_quantile(double p)
+{
+  static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                             -2.759285104469687e+02, 1.383577518672690e+02,
+                             -3.066479806614716e+01, 2.506628277459239e+00};
+  static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                             -1.556989798598866e+02, 6.680131188771972e+01,
+                             -1.328068155288572e+01};
+  static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                             -2.400758277161838e+00, -2.549732539343734e+00,
+                             4.374664141464968e+00,  2.938163982698783e+00};
+  static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                             3.754408661907416e+00};
+  double q, r, x;
+
+  if (p < 0.02425) {
+    q = sqrt(-2.0 * log(p));
+    x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+        ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+  } else if (p > 1.0 - 0.02425) {
+    q = sqrt(-2.0 * log(1.0 - p));
+    x = -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+        ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+  } else {
+    q = p - 0.5;
+    r = q * q;
+    x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+        (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+  }
+  double e = 0.5 * erfc(-x / M_SQRT2) - p;
+  double u = e * sqrt(2.0 * M_PI) * exp(x * x / 2.0);
+  return x - u / (1.0 + x * u / 2.0);
+}
+
+int sobol_direction(uint64_t seed, uint32_t index, double *v, int n)
+/* Stores in v[0..n-1] the unit vector of point `index` of the n-dimensional Sobol sequence, mapped
+ * to the sphere through the normal quantile. The sequence is scrambled by a digital shift drawn
+ * from `seed`, which keeps every point uniformly distributed. Returns 0 if n > SOBOL_DIM. */
+{
+  const uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+  uint32_t gray = index ^ (index >> 1), m[32], out[4];
+  double r2 = 0.0;
+
+  if (n > SOBOL_DIM)
+    return 0;
+  for (int j = 0; n > j; ++j) {
+    /* the shift of dimension j, from a stream no sample uses */
+    const uint32_t ctr[4] = {(uint32_t)j, 0, 0xFFFFFFFF, 0xFFFFFFFF};
+    philox4x32(key, ctr, out);
+    uint32_t x = out[0];
+    if (0 == j) {
+      for (int k = 0; 32 > k; ++k)
+        m[k] = 1;
+    } else {
+      int s = sobol_init[j - 1].s, a = sobol_init[j - 1].a;
+      for (int k = 0; 32 > k; ++k) {
+        if (s > k) {
+          m[k] = sobol_init[j - 1].m[k];
+          continue;
+        }
+        m[k] = m[k - s] ^ (m[k - s] << s);
+        for (int i = 1; s > i; ++i)
+          if ((a >> (s - 1 - i)) & 1)
+            m[k] ^= m[k - i] << i;
+      }
+    }
+    for (int k = 0; 32 > k; ++k)
+      if ((gray >> k) & 1)
+        x ^= m[k] << (31 - k);
+    v[j] = gauss_quantile((x + 0.5) / 4294967296.0);
+    r2 += v[j] * v[j];
+  }
+  for (int j = 0; n > j; ++j)
+    v[j] /= sqrt(r2);
+  return 1;
+}
 
 double gauss_deviate(long *idum)
 {
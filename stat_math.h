@@ -4,6 +4,7 @@
 #define STAT_MATH
 
 #include "numerical.h"
+#include <stdint.h>
 
 /* Returns the value n! as a floating-point number. */
 double factrl(int);
@@ -17,10 +18,16 @@ double nr_erfc(double);
 double gauss_integral(double, int);
 /* value of the n-dimensional complementary gaussian integral. */
 double gauss_integral_c(double, int);
+/* the same for each of an array of radii: q[i] = gauss_integral_c(r[i], n) */
+void gauss_integral_c_batch(const double *r, double *q, int num, int n);
 /* random number between 0 and 1 */
 double uniform_deviate(long *);
 /* random number with zero mean and unit varience */
 double gauss_deviate(long *);
+/* the first n random numbers with zero mean and unit variance of a reproducible stream */
+void counter_gauss(uint64_t seed, uint64_t stream, double *z, int n);
+/* unit vector of point `index` of a scrambled n-dimensional Sobol sequence (n <= 30) */
+int sobol_direction(uint64_t seed, uint32_t index, double *v, int n);
 /* returns the coordinates of a random point uniformly distributed in a unit hypersphere */
 /* r0 can be used to limit returned point to a shell of radius in the range r0-to-1 */
 double hypsphere_deviate(double *, long *, double, int);